@@ -0,0 +1,168 @@
+/// Z#20261019
+///  GLES 3.1 compute against the ES fragment path, the same kernel both ways, the outputs compared.
+///  a headless EGL context, mesa llvmpipe is enough.
+///
+///  g++ -std=c++11 -DFEATURE_ZHELPER_GLES31 -I.. es31_compute.cpp -o es31_compute -lEGL -lGLESv2
+///  ./es31_compute      exit code 0 when both paths agree
+///
+/// 1. the kernel has two outputs, out = in * 2 + 1 and lum = dot(out.rgb, w).
+/// 2. compute writes both in one dispatch, an image and an SSBO.
+/// 3. ES draws to GL_COLOR_ATTACHMENT0 only, the fragment path is one pass per output.
+#include "zes_helper.h"
+#include "zegl_helper.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace zhelper;
+
+static const int W = 37;        /// not a multiple of local_size, the tail groups are tested too
+static const int H = 23;
+
+static const char* computeSource =
+    "#version 310 es\n"
+    "layout(local_size_x = 8, local_size_y = 8) in;\n"
+    "layout(binding = 0, rgba32f) readonly uniform highp image2D uIn;\n"
+    "layout(binding = 1, rgba32f) writeonly uniform highp image2D uOut;\n"
+    "layout(std430, binding = 0) buffer Lum { float v[]; } lum;\n"
+    "void main() {\n"
+    "    ivec2 p = ivec2(gl_GlobalInvocationID.xy);\n"
+    "    ivec2 size = imageSize(uIn);\n"
+    "    if (p.x >= size.x || p.y >= size.y)\n"
+    "        return;\n"
+    "    vec4 c = imageLoad(uIn, p) * 2.0 + 1.0;\n"
+    "    imageStore(uOut, p, c);\n"
+    "    lum.v[p.y * size.x + p.x] = dot(c.rgb, vec3(0.25, 0.5, 0.25));\n"
+    "}\n";
+
+static const char* vertexSource =
+    "#version 300 es\n"
+    "void main() {\n"
+    "    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+    "    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);\n"
+    "}\n";
+
+/// uPass 0 writes out, 1 writes lum to .r
+static const char* fragmentSource =
+    "#version 300 es\n"
+    "precision highp float;\n"
+    "uniform highp sampler2D uIn;\n"
+    "uniform int uPass;\n"
+    "out vec4 o;\n"
+    "void main() {\n"
+    "    vec4 c = texelFetch(uIn, ivec2(gl_FragCoord.xy), 0) * 2.0 + 1.0;\n"
+    "    o = uPass == 0 ? c : vec4(dot(c.rgb, vec3(0.25, 0.5, 0.25)));\n"
+    "}\n";
+
+/// the stages may contract a * b + c into fma differently
+static bool same(float a, float b)
+{
+    return std::fabs(a - b) <= 1e-5f * std::max(1.0f, std::fabs(a));
+}
+
+static GLuint buildFragmentProgram()
+{
+    const char* sources[] = {vertexSource, fragmentSource};
+    GLenum types[] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER};
+    GLuint program = glCreateProgram();
+    for (int i = 0; i < 2; ++i)
+    {
+        GLuint shader = glCreateShader(types[i]);
+        glShaderSource(shader, 1, &sources[i], 0);
+        glCompileShader(shader);
+        glAttachShader(program, shader);
+        glDeleteShader(shader);
+    }
+    glLinkProgram(program);
+    GLint status = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    return status ? program : 0;
+}
+
+int main()
+{
+    EGL::GpuContext context;
+    if (!context.createGLES(3, 1) || !context.makeCurrent() || context.featureSet() != EGL::FEATURE_GLES31)
+    {
+        printf("no GLES 3.1 context\n");
+        return 2;
+    }
+    printf("%s, %s\n", context.info().version_.c_str(), context.info().renderer_.c_str());
+
+    std::vector<float> in(W * H * 4);
+    for (size_t i = 0; i < in.size(); ++i)
+        in[i] = (i % 97) * 0.25f;
+    GLES3::GpuImage2D input;
+    input.ensure(0);
+    input.alloc(GL_RGBA32F, W, H);
+    input.setGP();
+    input.copyFromCpuMemory(0, 0, W, H, GL_RGBA, GL_FLOAT, in.data());
+
+    /// compute, one dispatch
+    GLES3::GpuComputeProgram kernel;
+    if (!kernel.build(computeSource))
+    {
+        printf("%s\n", kernel.log_.c_str());
+        return 2;
+    }
+    GLES3::GpuImage2D output;
+    output.ensure(1);
+    output.alloc(GL_RGBA32F, W, H);
+    GLES3::GpuShaderStorageBuffer lum;
+    lum.ensure();
+    lum.alloc(W * H * sizeof(float), GL_DYNAMIC_COPY);
+    lum.bindBase(0);
+    input.bindImage(0, GL_READ_ONLY, GL_RGBA32F);
+    output.bindImage(1, GL_WRITE_ONLY, GL_RGBA32F);
+    kernel.ensure();
+    kernel.dispatch(W, H);
+    GLES3::GpuMemoryBarrier::forCpu();
+    kernel.leave();
+
+    std::vector<float> computeLum(W * H);
+    lum.copyTo(0, W * H * sizeof(float), computeLum.data());
+    lum.leave();
+    std::vector<float> computeOut(W * H * 4);
+    GLES3::GpuFBODevice<> fbo;
+    fbo.ensure();
+    fbo.color0PinGpuImage2D(output);
+    glReadPixels(0, 0, W, H, GL_RGBA, GL_FLOAT, computeOut.data());
+
+    /// fragment, one pass per output
+    GLuint program = buildFragmentProgram();
+    if (!program)
+        return 2;
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "uIn"), 0);
+    GLuint vao = 0;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glViewport(0, 0, W, H);
+    GLES3::GpuImage2D target;
+    target.ensure(2);
+    target.alloc(GL_RGBA32F, W, H);
+    fbo.color0PinGpuImage2D(target);
+    std::vector<float> fragmentOut(W * H * 4);
+    std::vector<float> fragmentLum(W * H * 4);
+    glUniform1i(glGetUniformLocation(program, "uPass"), 0);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glReadPixels(0, 0, W, H, GL_RGBA, GL_FLOAT, fragmentOut.data());
+    glUniform1i(glGetUniformLocation(program, "uPass"), 1);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glReadPixels(0, 0, W, H, GL_RGBA, GL_FLOAT, fragmentLum.data());
+    glBindVertexArray(0);
+    glDeleteVertexArrays(1, &vao);
+    glUseProgram(0);
+    glDeleteProgram(program);
+    fbo.leave();
+
+    int bad = 0;
+    for (int i = 0; i < W * H * 4; ++i)
+        bad += !same(computeOut[i], fragmentOut[i]);
+    for (int i = 0; i < W * H; ++i)
+        bad += !same(computeLum[i], fragmentLum[i * 4]);
+    GLenum error = glGetError();
+    printf("%d mismatches, gl error 0x%x\n", bad, error);
+    return (bad || error) ? 1 : 0;
+}
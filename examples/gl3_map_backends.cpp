@@ -0,0 +1,87 @@
+/// Z#20261019
+///  GpuMapKernel::measure(), the gl face against the cpu face of one kernel, throughput printed, the outputs compared.
+///  a headless EGL context, mesa llvmpipe is enough, where the gl face runs on the cpu too.
+///
+///  g++ -std=c++11 -O2 -mavx2 -DFEATURE_ZHELPER_GL2_USE_SOFTWARE -DGL_GLEXT_PROTOTYPES -I.. gl3_map_backends.cpp -o gl3_map_backends -lEGL -lGL -lpthread
+///  ./gl3_map_backends [size] [runs]     exit code 0 when both faces agree
+///
+/// 1. out = in0 * 2 + in1, R32F, size x size texels, 1024 by default.
+/// 2. measure() is called runs times, 10 by default, the timings are averaged.
+///    the gl timing includes the uploads and the readback, as GpuMapKernel::runGL().
+/// 3. the outputs of runGL() and runCPU() are compared after the timings.
+#include "zgl_helper.h"
+#include "zegl_helper.h"
+#include "zcpu_helper.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace zhelper;
+
+static const char* kernelSource =
+    "vec4 kernel(ivec2 p) {\n"
+    "    return texelFetch(uIn0, p, 0) * 2.0 + texelFetch(uIn1, p, 0);\n"
+    "}\n";
+
+static void kernelSpan(const CPU::Span& span)
+{
+    GLsizei n = span.count_ * span.channels_;
+    for (GLsizei i = 0; i < n; ++i)
+        span.out_[i] = span.in_[0][i] * 2.0f + span.in_[1][i];
+}
+
+int main(int argc, char* argv[])
+{
+    int size = argc > 1 ? atoi(argv[1]) : 1024;
+    int runs = argc > 2 ? atoi(argv[2]) : 10;
+    if (size <= 0 || runs <= 0)
+        return 2;
+
+    EGL::GpuContext context;
+    if (!context.createGL(4, 5) || !context.makeCurrent() || context.featureSet() < EGL::FEATURE_GL3)
+    {
+        printf("no GL 4.5 core context\n");
+        return 2;
+    }
+    printf("%s, %s\n", context.info().version_.c_str(), context.info().renderer_.c_str());
+
+    size_t texels = (size_t)size * size;
+    std::vector<float> a(texels), b(texels), glOut(texels), cpuOut(texels);
+    for (size_t i = 0; i < texels; ++i)
+    {
+        a[i] = (i % 97) * 0.25f;
+        b[i] = (i % 13) * 0.5f;
+    }
+    CPU::Dataset inputs[2] = {CPU::Dataset(a.data(), size, size), CPU::Dataset(b.data(), size, size)};
+    CPU::Dataset glOutput(glOut.data(), size, size), cpuOutput(cpuOut.data(), size, size);
+
+    GL3::GpuMapKernel<> kernel(kernelSource, kernelSpan);
+    if (!kernel.runGL(inputs, 2, glOutput))
+    {
+        printf("%s\n", kernel.program_.log_.c_str());
+        return 2;
+    }
+
+    GL3::GpuBackendTimings total;
+    for (int i = 0; i < runs; ++i)
+    {
+        GL3::GpuBackendTimings t = kernel.measure(inputs, 2, cpuOutput);
+        total.gl_ += t.gl_;
+        total.cpu_ += t.cpu_;
+        total.texels_ += t.texels_;
+    }
+
+    kernel.runGL(inputs, 2, glOutput);
+    kernel.runCPU(inputs, 2, cpuOutput);
+    int bad = 0;
+    for (size_t i = 0; i < texels; ++i)
+        bad += glOut[i] != cpuOut[i];
+
+    GLenum error = glGetError();
+    printf("%dx%d R32F, 2 inputs, %d runs, %u cpu threads\n", size, size, runs, (unsigned)CPU::ThreadPool::shared().concurrency());
+    printf("gl  %.3f ms/run, %.1f Mtexels/s\n", total.gl_ * 1e3 / runs, total.glTexelsPerSecond() * 1e-6);
+    printf("cpu %.3f ms/run, %.1f Mtexels/s\n", total.cpu_ * 1e3 / runs, total.cpuTexelsPerSecond() * 1e-6);
+    printf("chosen %s\n", kernel.backend() == GL3::BACKEND_GL ? "gl" : "cpu");
+    printf("%d mismatches, gl error 0x%x\n", bad, error);
+    return (bad || error) ? 1 : 0;
+}
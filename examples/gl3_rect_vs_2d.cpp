@@ -0,0 +1,134 @@
+/// Z#20261019
+///  GpuImageRect against GpuImage2D, the same +1 kernel both ways, timed, the outputs compared.
+///  a headless EGL context, GL 4.2 at least for the immutable storage, mesa llvmpipe is enough.
+///
+///  g++ -std=c++11 -O2 -DFEATURE_ZHELPER_GL2_USE_SOFTWARE -DGL_GLEXT_PROTOTYPES -I.. gl3_rect_vs_2d.cpp -o gl3_rect_vs_2d -lEGL -lGL
+///  ./gl3_rect_vs_2d [size] [passes]     exit code 0 when both paths agree
+///
+/// 1. R32F, size x size texels, 1024 by default. each path is warmed up once, then timed over passes.
+/// 2. the rect kernel reads by gl_FragCoord.xy, the 2D kernel by gl_FragCoord.xy * uInvSize,
+///    both filter GL_NEAREST, so the results are equal texel by texel.
+/// 3. glFinish() closes each timing, the numbers are wall time per pass on this driver,
+///    compare them on the target gpu before choosing one.
+#include "zgl_helper.h"
+#include "zegl_helper.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace zhelper;
+
+static const char* rectSource =
+    "#version 330 core\n"
+    "uniform sampler2DRect uIn0;\n"
+    "out vec4 o;\n"
+    "void main() {\n"
+    "    o = vec4(texture(uIn0, gl_FragCoord.xy).r + 1.0);\n"
+    "}\n";
+
+static const char* normalizedSource =
+    "#version 330 core\n"
+    "uniform sampler2D uIn0;\n"
+    "uniform vec2 uInvSize;\n"
+    "out vec4 o;\n"
+    "void main() {\n"
+    "    o = vec4(texture(uIn0, gl_FragCoord.xy * uInvSize).r + 1.0);\n"
+    "}\n";
+
+/// ms per pass, the input is bound to unit 0 by launch()
+template<typename _In>
+static double timePasses(GL3::GpuLauncher& launcher, GL3::GpuProgram& program,
+                         GL3::GpuImage2D& output, _In& input, int size, int passes)
+{
+    launcher.launch(program, output, size, size, input);
+    glFinish();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < passes; ++i)
+        launcher.launch(program, output, size, size, input);
+    glFinish();
+    std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now() - start;
+    return ms.count() / passes;
+}
+
+static void readBack(GL3::GpuLauncher& launcher, GL3::GpuImage2D& output, int size, std::vector<float>& texels)
+{
+    texels.resize((size_t)size * size);
+    launcher.dev_.ensure();
+    launcher.dev_.color0PinGpuImage(output);
+    GL2::GpuPixelStoreSaver<GL_PACK_ALIGNMENT> align(1);
+    glReadPixels(0, 0, size, size, GL_RED, GL_FLOAT, texels.data());
+    launcher.dev_.color0PinTexture(0);
+    launcher.dev_.leave();
+}
+
+int main(int argc, char* argv[])
+{
+    int size = argc > 1 ? atoi(argv[1]) : 1024;
+    int passes = argc > 2 ? atoi(argv[2]) : 50;
+    if (size <= 0 || passes <= 0)
+        return 2;
+
+    EGL::GpuContext context;
+    if (!context.createGL(4, 5) || !context.makeCurrent() || context.featureSet() < EGL::FEATURE_GL3)
+    {
+        printf("no GL 4.5 core context\n");
+        return 2;
+    }
+    printf("%s, %s\n", context.info().version_.c_str(), context.info().renderer_.c_str());
+
+    std::vector<float> in((size_t)size * size);
+    for (size_t i = 0; i < in.size(); ++i)
+        in[i] = (i % 97) * 0.25f;
+    GL2::GpuPixelStoreSaver<GL_UNPACK_ALIGNMENT> align(1);
+
+    GL3::GpuImageRect rect;
+    rect.ensure(0);
+    rect.alloc(GL_R32F, size, size);
+    rect.setGP();
+    rect.copyFromCpuMemory(0, 0, size, size, GL_RED, GL_FLOAT, in.data());
+
+    GL3::GpuImage2D normalized;
+    normalized.ensure(0);
+    normalized.alloc(GL_R32F, size, size);
+    normalized.setGP();
+    normalized.copyFromCpuMemory(0, 0, size, size, GL_RED, GL_FLOAT, in.data());
+
+    GL3::GpuProgram rectKernel, normalizedKernel;
+    if (!GL3::GpuLauncher::build(rectKernel, rectSource) || !GL3::GpuLauncher::build(normalizedKernel, normalizedSource))
+    {
+        printf("%s%s\n", rectKernel.log_.c_str(), normalizedKernel.log_.c_str());
+        return 2;
+    }
+    normalizedKernel.ensure();
+    normalizedKernel.setUniform1i("uIn0", 0);
+    GLfloat invSize[2] = {1.0f / size, 1.0f / size};
+    glUniform2fv(normalizedKernel.uniform("uInvSize"), 1, invSize);
+    normalizedKernel.leave();
+    rectKernel.ensure();
+    rectKernel.setUniform1i("uIn0", 0);
+    rectKernel.leave();
+
+    GL3::GpuImage2D rectOut, normalizedOut;
+    rectOut.ensure(1);
+    rectOut.alloc(GL_R32F, size, size);
+    normalizedOut.ensure(1);
+    normalizedOut.alloc(GL_R32F, size, size);
+
+    GL3::GpuLauncher launcher;
+    double rectMs = timePasses(launcher, rectKernel, rectOut, rect, size, passes);
+    double normalizedMs = timePasses(launcher, normalizedKernel, normalizedOut, normalized, size, passes);
+
+    std::vector<float> rectTexels, normalizedTexels;
+    readBack(launcher, rectOut, size, rectTexels);
+    readBack(launcher, normalizedOut, size, normalizedTexels);
+    int bad = 0;
+    for (size_t i = 0; i < in.size(); ++i)
+        bad += rectTexels[i] != in[i] + 1.0f || normalizedTexels[i] != rectTexels[i];
+
+    GLenum error = glGetError();
+    printf("%dx%d R32F, %d passes\n", size, size, passes);
+    printf("GpuImageRect %.3f ms/pass, GpuImage2D %.3f ms/pass\n", rectMs, normalizedMs);
+    printf("%d mismatches, gl error 0x%x\n", bad, error);
+    return (bad || error) ? 1 : 0;
+}
@@ -0,0 +1,411 @@
+/**
+MIT License
+
+Copyright (c) 2022-2024 bbqz007 <https://github.com/bbqz007, http://www.cnblogs.com/bbqzsl>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __ZHELPER_CAPTURE_H_
+#define __ZHELPER_CAPTURE_H_
+
+#if !defined(__ZHELPER_GL2_H_)
+#error "include zgl_helper.h before zcapture_helper.h"
+#endif
+
+#include "zcpu_helper.h"
+#include <cstdio>
+#include <vector>
+#ifdef FEATURE_ZHELPER_USE_ZLIB
+#include <zlib.h>
+#endif // FEATURE_ZHELPER_USE_ZLIB
+
+/// Z#20261019 Design
+///  glReadPixels to the cpu memory, then encode on the same thread,
+///  the gl thread waits for the dma, and the gpu waits for the encoder.
+///  the encoder reads frames into the PBO ring of GL3::GpuFrameCapture, and the workers encode the mapped PBOs.
+///
+/// 1. the ring in lend mode, a slot goes capture -> fence -> mapped and lent -> reclaimed.
+/// 1.a capture(), glReadPixels to the PBO of the slot, a fence.
+/// 1.b poll(), the fence has passed, the ring maps the PBO on the gl thread,
+///     the encoder posts the pointer to CPU::WorkQueue.
+/// 1.c the worker flips (rows bottom up to top down) while encoding, no extra copy,
+///     calls sink_, and marks the slot done.
+/// 1.d poll(), a done slot is reclaimed, the ring unmaps it on the gl thread.
+/// 2. a slot is mapped only while a worker reads it, map and unmap are on the gl thread,
+///    the workers never call gl.
+/// 3. capture() on a slot not reclaimed waits for it, so _Depth frames at most are in flight.
+/// 4. sink_ is called on a worker thread, frames may be out of order, see the frame number.
+/// 5. formats
+/// 5.a CAPTURE_RAW, rgba top down, no header.
+/// 5.b CAPTURE_QOI, https://qoiformat.org, about 20x the speed of zlib, a bit larger.
+/// 5.c CAPTURE_PNG, deflate stored blocks (no compression),
+///     or zlib level level_ with FEATURE_ZHELPER_USE_ZLIB (link -lz).
+///
+/// LIMIT:
+/// 1. rgba8 only, the alpha is kept.
+
+namespace zhelper
+{
+namespace CPU
+{
+    enum CaptureFormat
+    {
+        CAPTURE_RAW = 0,
+        CAPTURE_QOI,
+        CAPTURE_PNG,
+    };
+
+    /// rgba8 frames to bytes, the rows of rgba_ are bottom up as glReadPixels unless topDown_.
+    struct ImageEncoder
+    {
+        const unsigned char* rgba_ = 0;
+        GLsizei width_ = 0;
+        GLsizei height_ = 0;
+        bool topDown_ = false;
+        int level_ = 6;     /// zlib level, CAPTURE_PNG with FEATURE_ZHELPER_USE_ZLIB
+
+        ImageEncoder(const unsigned char* rgba, GLsizei width, GLsizei height, bool topDown = false)
+            : rgba_(rgba), width_(width), height_(height), topDown_(topDown)
+        {
+        }
+        /// the y-th row from the top
+        const unsigned char* row(GLsizei y) const
+        {
+            return rgba_ + (size_t)(topDown_ ? y : height_ - 1 - y) * width_ * 4;
+        }
+        void encode(CaptureFormat format, std::vector<unsigned char>& out) const
+        {
+            out.clear();
+            switch (format)
+            {
+            case CAPTURE_QOI:
+                encodeQOI(out);
+                break;
+            case CAPTURE_PNG:
+                encodePNG(out);
+                break;
+            default:
+                encodeRaw(out);
+                break;
+            }
+        }
+        void encodeRaw(std::vector<unsigned char>& out) const
+        {
+            size_t stride = (size_t)width_ * 4;
+            out.resize(stride * height_);
+            for (GLsizei y = 0; y < height_; ++y)
+                memcpy(out.data() + stride * y, row(y), stride);
+        }
+        void encodeQOI(std::vector<unsigned char>& out) const
+        {
+            out.reserve(14 + (size_t)width_ * height_ * 2 + 8);
+            static const unsigned char magic[4] = {'q', 'o', 'i', 'f'};
+            out.insert(out.end(), magic, magic + 4);
+            putBE32(out, (unsigned)width_);
+            putBE32(out, (unsigned)height_);
+            out.push_back(4);   /// channels
+            out.push_back(0);   /// srgb with linear alpha
+            unsigned char index[64][4];
+            memset(index, 0, sizeof(index));
+            unsigned char prev[4] = {0, 0, 0, 255};
+            int run = 0;
+            size_t last = (size_t)width_ * height_ - 1, i = 0;
+            for (GLsizei y = 0; y < height_; ++y)
+            {
+                const unsigned char* px = row(y);
+                for (GLsizei x = 0; x < width_; ++x, px += 4, ++i)
+                {
+                    if (!memcmp(px, prev, 4))
+                    {
+                        if (++run == 62 || i == last)
+                        {
+                            out.push_back((unsigned char)(0xc0 | (run - 1)));
+                            run = 0;
+                        }
+                        continue;
+                    }
+                    if (run)
+                    {
+                        out.push_back((unsigned char)(0xc0 | (run - 1)));
+                        run = 0;
+                    }
+                    int h = (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64;
+                    if (!memcmp(index[h], px, 4))
+                        out.push_back((unsigned char)h);
+                    else
+                    {
+                        memcpy(index[h], px, 4);
+                        if (px[3] == prev[3])
+                        {
+                            signed char vr = (signed char)(px[0] - prev[0]);
+                            signed char vg = (signed char)(px[1] - prev[1]);
+                            signed char vb = (signed char)(px[2] - prev[2]);
+                            signed char vgr = (signed char)(vr - vg);
+                            signed char vgb = (signed char)(vb - vg);
+                            if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2)
+                                out.push_back((unsigned char)(0x40 | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2)));
+                            else if (vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8)
+                            {
+                                out.push_back((unsigned char)(0x80 | (vg + 32)));
+                                out.push_back((unsigned char)((vgr + 8) << 4 | (vgb + 8)));
+                            }
+                            else
+                            {
+                                out.push_back(0xfe);
+                                out.insert(out.end(), px, px + 3);
+                            }
+                        }
+                        else
+                        {
+                            out.push_back(0xff);
+                            out.insert(out.end(), px, px + 4);
+                        }
+                    }
+                    memcpy(prev, px, 4);
+                }
+            }
+            static const unsigned char padding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+            out.insert(out.end(), padding, padding + 8);
+        }
+        void encodePNG(std::vector<unsigned char>& out) const
+        {
+            static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+            out.insert(out.end(), signature, signature + 8);
+            unsigned char ihdr[13] = {0};
+            putBE32(ihdr, (unsigned)width_);
+            putBE32(ihdr + 4, (unsigned)height_);
+            ihdr[8] = 8;    /// bit depth
+            ihdr[9] = 6;    /// rgba
+            putChunk(out, "IHDR", ihdr, sizeof(ihdr));
+            /// filter byte 0 (none) before every row
+            size_t stride = (size_t)width_ * 4 + 1;
+            std::vector<unsigned char> scanlines(stride * height_);
+            for (GLsizei y = 0; y < height_; ++y)
+            {
+                scanlines[stride * y] = 0;
+                memcpy(&scanlines[stride * y + 1], row(y), stride - 1);
+            }
+            std::vector<unsigned char> idat;
+            deflate(scanlines, idat);
+            putChunk(out, "IDAT", idat.data(), idat.size());
+            putChunk(out, "IEND", 0, 0);
+        }
+        static unsigned crc32(unsigned crc, const unsigned char* p, size_t n)
+        {
+            static unsigned table[256];
+            static bool init = []() {
+                for (unsigned i = 0; i < 256; ++i)
+                {
+                    unsigned c = i;
+                    for (int k = 0; k < 8; ++k)
+                        c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                    table[i] = c;
+                }
+                return true;
+            }();
+            (void)init;
+            crc = ~crc;
+            for (size_t i = 0; i < n; ++i)
+                crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+            return ~crc;
+        }
+        static unsigned adler32(const unsigned char* p, size_t n)
+        {
+            unsigned a = 1, b = 0;
+            while (n)
+            {
+                /// 5552, the most bytes before b overflows
+                size_t k = (n < 5552) ? n : 5552;
+                n -= k;
+                while (k--)
+                {
+                    a += *p++;
+                    b += a;
+                }
+                a %= 65521;
+                b %= 65521;
+            }
+            return (b << 16) | a;
+        }
+    private:
+        static void putBE32(unsigned char* p, unsigned v)
+        {
+            p[0] = (unsigned char)(v >> 24);
+            p[1] = (unsigned char)(v >> 16);
+            p[2] = (unsigned char)(v >> 8);
+            p[3] = (unsigned char)v;
+        }
+        static void putBE32(std::vector<unsigned char>& out, unsigned v)
+        {
+            unsigned char b[4];
+            putBE32(b, v);
+            out.insert(out.end(), b, b + 4);
+        }
+        static void putChunk(std::vector<unsigned char>& out, const char* type, const unsigned char* data, size_t n)
+        {
+            putBE32(out, (unsigned)n);
+            size_t at = out.size();
+            out.insert(out.end(), type, type + 4);
+            if (n)
+                out.insert(out.end(), data, data + n);
+            putBE32(out, crc32(0, &out[at], n + 4));
+        }
+        /// a zlib stream
+        void deflate(const std::vector<unsigned char>& in, std::vector<unsigned char>& out) const
+        {
+#ifdef FEATURE_ZHELPER_USE_ZLIB
+            uLongf n = compressBound((uLong)in.size());
+            out.resize(n);
+            if (compress2(out.data(), &n, in.data(), (uLong)in.size(), level_) == Z_OK)
+            {
+                out.resize(n);
+                return;
+            }
+            out.clear();
+#endif // FEATURE_ZHELPER_USE_ZLIB
+            /// cmf deflate 32K window, flg no dict, fastest, (0x78 << 8 | 0x01) % 31 == 0
+            out.reserve(in.size() + in.size() / 65535 * 5 + 11);
+            out.push_back(0x78);
+            out.push_back(0x01);
+            size_t at = 0;
+            do
+            {
+                size_t n = in.size() - at;
+                if (n > 65535)
+                    n = 65535;
+                out.push_back((at + n == in.size()) ? 1 : 0);   /// BFINAL, BTYPE 00 stored
+                out.push_back((unsigned char)n);
+                out.push_back((unsigned char)(n >> 8));
+                out.push_back((unsigned char)~n);
+                out.push_back((unsigned char)(~n >> 8));
+                out.insert(out.end(), in.begin() + at, in.begin() + at + n);
+                at += n;
+            } while (at < in.size());
+            putBE32(out, adler32(in.data(), in.size()));
+        }
+    };
+}; // NS CPU
+}; // NS zhelper
+
+namespace zhelper
+{
+namespace GL3
+{
+    template<int _Depth = 4>
+    struct GpuCaptureEncoder
+    {
+        typedef std::function<void(unsigned long long, const std::vector<unsigned char>&)> Sink;
+
+        GpuFrameCapture<_Depth> ring_;
+        CPU::WorkQueue* queue_;
+        CPU::CaptureFormat format_;
+        int level_ = 6;
+        Sink sink_;     /// on a worker thread
+        std::atomic<bool> encoded_[_Depth];
+        std::mutex mtx_;
+        std::condition_variable done_;
+
+        explicit GpuCaptureEncoder(CPU::WorkQueue& queue, CPU::CaptureFormat format = CPU::CAPTURE_QOI)
+            : queue_(&queue), format_(format)
+        {
+            for (int i = 0; i < _Depth; ++i)
+                encoded_[i] = false;
+            ring_.lend_ = [this](int slot, unsigned long long frame, const unsigned char* rgba, GLsizei width, GLsizei height) {
+                encode(slot, frame, rgba, width, height);
+            };
+            /// Z#20261019 bug
+            ///  the blocking path returned on encoded_ without the lock, flush() of the destructor could
+            ///  return while the worker was still inside notify_all, mtx_ and done_ were destroyed under it.
+            ring_.reclaim_ = [this](int slot, bool block) {
+                if (!block)
+                    return encoded_[slot].load();
+                std::unique_lock<std::mutex> lk(mtx_);
+                done_.wait(lk, [this, slot]() { return encoded_[slot].load(); });
+                return true;
+            };
+        }
+        /// the workers read the mapped PBOs, all of them finish first.
+        ///  slots reclaimed by poll() did not take the lock, the last worker may still hold it.
+        ~GpuCaptureEncoder()
+        {
+            flush();
+            std::lock_guard<std::mutex> lk(mtx_);
+        }
+        /// the rgba of the current read framebuffer, GL_COLOR_ATTACHMENT0 of a FBO or GL_BACK
+        unsigned long long capture(GLint x, GLint y, GLsizei width, GLsizei height)
+        {
+            return ring_.capture(x, y, width, height);
+        }
+        /// the resolved image of the target
+        unsigned long long capture(GpuOffscreenTarget& target)
+        {
+            return ring_.capture(target);
+        }
+        /// never blocks, finished reads passed to the workers, encoded slots reclaimed.
+        ///  returns the slots in flight.
+        size_t poll()
+        {
+            ring_.poll();
+            return ring_.inFlight();
+        }
+        /// every captured frame is encoded and sunk
+        void flush()
+        {
+            ring_.flush();
+        }
+    private:
+        void encode(int slot, unsigned long long frame, const unsigned char* rgba, GLsizei width, GLsizei height)
+        {
+            encoded_[slot] = false;
+            CPU::CaptureFormat format = format_;
+            int level = level_;
+            Sink sink = sink_;
+            queue_->post([this, slot, frame, rgba, width, height, format, level, sink]() {
+                CPU::ImageEncoder encoder(rgba, width, height);
+                encoder.level_ = level;
+                std::vector<unsigned char> bytes;
+                encoder.encode(format, bytes);
+                if (sink)
+                    sink(frame, bytes);
+                /// notified under the lock, the encoder may be destroyed right after it
+                std::lock_guard<std::mutex> lk(mtx_);
+                encoded_[slot] = true;
+                done_.notify_all();
+            });
+        }
+    };
+
+    /// a sink writing one file per frame, pattern as "frame%06llu.qoi"
+    inline std::function<void(unsigned long long, const std::vector<unsigned char>&)> GpuCaptureFileSink(const std::string& pattern)
+    {
+        return [pattern](unsigned long long frame, const std::vector<unsigned char>& bytes) {
+            char path[4096];
+            snprintf(path, sizeof(path), pattern.c_str(), frame);
+            FILE* f = fopen(path, "wb");
+            if (!f)
+                return;
+            fwrite(bytes.data(), 1, bytes.size(), f);
+            fclose(f);
+        };
+    }
+}; // NS GL3
+}; // NS zhelper
+
+#endif // __ZHELPER_CAPTURE_H_
@@ -0,0 +1,455 @@
+/**
+MIT License
+
+Copyright (c) 2022-2024 bbqz007 <https://github.com/bbqz007, http://www.cnblogs.com/bbqzsl>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __ZHELPER_CPU_H_
+#define __ZHELPER_CPU_H_
+
+#include "zgl_helper.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/// Z#20261019 Design
+///  on hosts with llvmpipe only (FEATURE_ZHELPER_GL2_USE_SOFTWARE or mesa without gpu),
+///  the gl path is executed by the cpu, and still pays the full transfer cost.
+///  so a kernel has two faces, the same dataset in and out.
+///
+/// 1. GLSL face, `vec4 kernel(ivec2 p)`, reads inputs by texelFetch(uIn0, p, 0), uIn1, ...
+/// 1.a executed by GpuMapKernel::runGL(), inputs are uploaded to GpuImage2D as _Fmt,
+///     output is drawn to a GpuImage2D pinned to FBO, and read back.
+/// 2. C++ face, a functor called on spans of one row, `void (const CPU::Span&)`.
+/// 2.a executed by GpuMapKernel::runCPU(), rows are shared by the threads of CPU::ThreadPool.
+/// 2.b the span is contiguous (channels interleaved), write the inner loop plain,
+///     the compiler vectorizes it (-O2 -mavx2), or use the intrinsics yourself.
+/// 3. BACKEND_AUTO measures both faces on the first run(), and keeps the faster one.
+/// 3.a measure() can be called any time, it is the benchmark between the two paths.
+/// 3.b without a current context, it is the cpu face.
+///
+/// LIMIT:
+/// 1. float formats only, see GL3::GpuFormat. integer formats need isampler2D.
+/// 2. the output has the size of the inputs, at most 8 inputs.
+
+namespace zhelper
+{
+namespace CPU
+{
+    /// host dataset, row major, channels interleaved, the same layout as GpuImage2D.
+    struct Dataset
+    {
+        float* data_ = 0;
+        GLsizei width_ = 0;
+        GLsizei height_ = 0;
+        GLint channels_ = 1;
+
+        Dataset() {}
+        Dataset(float* data, GLsizei width, GLsizei height, GLint channels = 1)
+            : data_(data), width_(width), height_(height), channels_(channels)
+        {
+        }
+        float* row(GLint y) const
+        {
+            return data_ + (size_t)y * width_ * channels_;
+        }
+        const float* texel(GLint x, GLint y) const
+        {
+            return row(y) + (size_t)x * channels_;
+        }
+        size_t size() const
+        {
+            return (size_t)width_ * height_ * channels_;
+        }
+    };
+
+    enum { MAX_INPUTS = 8 };
+
+    /// a part of a row, [x_, x_ + count_) at y_
+    struct Span
+    {
+        GLint x_;
+        GLint y_;
+        GLsizei count_;             /// texels
+        GLint channels_;
+        const float* in_[MAX_INPUTS];  /// at (x_, y_) of every input
+        float* out_;                /// at (x_, y_) of the output
+        const Dataset* src_;        /// whole inputs, for kernels reading neighbours
+        GLint inputs_;
+    };
+
+    /// fixed threads, the calling thread works too.
+    struct ThreadPool
+    {
+        struct Batch
+        {
+            std::function<void(size_t, size_t)> fn_;
+            size_t n_;
+            size_t grain_;
+            std::atomic<size_t> next_;
+            void work()
+            {
+                for (;;)
+                {
+                    size_t begin = next_.fetch_add(grain_);
+                    if (begin >= n_)
+                        break;
+                    fn_(begin, std::min(n_, begin + grain_));
+                }
+            }
+        };
+        std::vector<std::thread> threads_;
+        std::mutex callMtx_;    /// one parallelFor at a time
+        std::mutex mtx_;
+        std::condition_variable cv_;
+        std::condition_variable done_;
+        std::shared_ptr<Batch> batch_;
+        unsigned generation_ = 0;
+        unsigned active_ = 0;
+        bool stop_ = false;
+
+        /// 0 for hardware_concurrency() - 1 threads
+        explicit ThreadPool(unsigned threads = 0)
+        {
+            if (!threads)
+            {
+                unsigned hw = std::thread::hardware_concurrency();
+                threads = (hw > 1) ? hw - 1 : 0;
+            }
+            for (unsigned i = 0; i < threads; ++i)
+                threads_.emplace_back([this]() { run(); });
+        }
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lk(mtx_);
+                stop_ = true;
+            }
+            cv_.notify_all();
+            for (size_t i = 0; i < threads_.size(); ++i)
+                threads_[i].join();
+        }
+        static ThreadPool& shared()
+        {
+            static ThreadPool pool;
+            return pool;
+        }
+        size_t concurrency() const
+        {
+            return threads_.size() + 1;
+        }
+        /// fn(begin, end) on [0, n), in chunks of grain, returns when all done.
+        void parallelFor(size_t n, size_t grain, std::function<void(size_t, size_t)> fn)
+        {
+            if (!n)
+                return;
+            std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+            batch->fn_ = std::move(fn);
+            batch->n_ = n;
+            batch->grain_ = grain ? grain : 1;
+            batch->next_ = 0;
+            if (threads_.empty() || n <= batch->grain_)
+            {
+                batch->work();
+                return;
+            }
+            std::lock_guard<std::mutex> call(callMtx_);
+            {
+                std::lock_guard<std::mutex> lk(mtx_);
+                batch_ = batch;
+                ++generation_;
+            }
+            cv_.notify_all();
+            batch->work();
+            std::unique_lock<std::mutex> lk(mtx_);
+            done_.wait(lk, [this]() { return active_ == 0; });
+            batch_.reset();
+        }
+    private:
+        void run()
+        {
+            unsigned seen = 0;
+            for (;;)
+            {
+                std::shared_ptr<Batch> batch;
+                {
+                    std::unique_lock<std::mutex> lk(mtx_);
+                    cv_.wait(lk, [this, seen]() { return stop_ || (batch_ && generation_ != seen); });
+                    if (stop_)
+                        break;
+                    seen = generation_;
+                    batch = batch_;
+                    ++active_;
+                }
+                batch->work();
+                {
+                    std::lock_guard<std::mutex> lk(mtx_);
+                    --active_;
+                }
+                done_.notify_one();
+            }
+        }
+    };
+
+    /// fixed threads, tasks posted and not joined, for the jobs overlapping the gl thread.
+    ///  ThreadPool::parallelFor returns when the batch is done, the queue returns at once.
+    struct WorkQueue
+    {
+        std::vector<std::thread> threads_;
+        std::deque<std::function<void()>> tasks_;
+        std::mutex mtx_;
+        std::condition_variable cv_;
+        std::condition_variable idle_;
+        unsigned running_ = 0;
+        bool stop_ = false;
+
+        /// 0 for hardware_concurrency() - 1 threads, at least one
+        explicit WorkQueue(unsigned threads = 0)
+        {
+            if (!threads)
+            {
+                unsigned hw = std::thread::hardware_concurrency();
+                threads = (hw > 2) ? hw - 1 : 1;
+            }
+            for (unsigned i = 0; i < threads; ++i)
+                threads_.emplace_back([this]() { run(); });
+        }
+        /// the posted tasks are run before the threads exit
+        ~WorkQueue()
+        {
+            {
+                std::lock_guard<std::mutex> lk(mtx_);
+                stop_ = true;
+            }
+            cv_.notify_all();
+            for (size_t i = 0; i < threads_.size(); ++i)
+                threads_[i].join();
+        }
+        void post(std::function<void()> task)
+        {
+            {
+                std::lock_guard<std::mutex> lk(mtx_);
+                tasks_.push_back(std::move(task));
+            }
+            cv_.notify_one();
+        }
+        /// returns when no task is queued or running
+        void wait()
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            idle_.wait(lk, [this]() { return tasks_.empty() && !running_; });
+        }
+        size_t concurrency() const
+        {
+            return threads_.size();
+        }
+    private:
+        void run()
+        {
+            for (;;)
+            {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lk(mtx_);
+                    cv_.wait(lk, [this]() { return stop_ || !tasks_.empty(); });
+                    if (tasks_.empty())
+                        break;
+                    task = std::move(tasks_.front());
+                    tasks_.pop_front();
+                    ++running_;
+                }
+                task();
+                {
+                    std::lock_guard<std::mutex> lk(mtx_);
+                    --running_;
+                }
+                idle_.notify_all();
+            }
+        }
+    };
+}; // NS CPU
+}; // NS zhelper
+
+namespace zhelper
+{
+namespace GL3
+{
+    enum GpuBackend
+    {
+        BACKEND_AUTO = 0,
+        BACKEND_GL,
+        BACKEND_CPU,
+    };
+
+    /// seconds of one run, transfers included for the gl path
+    struct GpuBackendTimings
+    {
+        double gl_ = 0;
+        double cpu_ = 0;
+        size_t texels_ = 0;
+
+        double glTexelsPerSecond() const
+        {
+            return gl_ > 0 ? texels_ / gl_ : 0;
+        }
+        double cpuTexelsPerSecond() const
+        {
+            return cpu_ > 0 ? texels_ / cpu_ : 0;
+        }
+    };
+
+    template<typename _Fmt = GpuFormatR32F>
+    struct GpuMapKernel
+    {
+        std::string glsl_;
+        std::function<void(const CPU::Span&)> cpu_;
+        GpuBackend backend_ = BACKEND_AUTO;
+        GpuBackend chosen_ = BACKEND_AUTO;
+        GpuBackendTimings timings_;
+        CPU::ThreadPool* pool_ = 0;
+
+        GpuProgram program_;
+        GpuImage2D images_[CPU::MAX_INPUTS];
+        GpuImage2D output_;
+        GpuLauncher launcher_;
+
+        GpuMapKernel(const std::string& glsl, std::function<void(const CPU::Span&)> cpu)
+            : glsl_(glsl), cpu_(std::move(cpu))
+        {
+        }
+        /// the chosen backend, BACKEND_AUTO until the first run()
+        GpuBackend backend() const
+        {
+            return (backend_ != BACKEND_AUTO) ? backend_ : chosen_;
+        }
+        void run(const CPU::Dataset* inputs, GLint n, CPU::Dataset& output)
+        {
+            if (backend_ == BACKEND_CPU || !hasContext())
+                runCPU(inputs, n, output);
+            else if (backend_ == BACKEND_GL)
+                runGL(inputs, n, output);
+            else if (chosen_ == BACKEND_AUTO)
+                measure(inputs, n, output);
+            else if (chosen_ == BACKEND_GL)
+                runGL(inputs, n, output);
+            else
+                runCPU(inputs, n, output);
+        }
+        /// runs both paths, the output is written twice.
+        /// the first gl run builds the program and textures, it is not counted.
+        GpuBackendTimings measure(const CPU::Dataset* inputs, GLint n, CPU::Dataset& output)
+        {
+            typedef std::chrono::steady_clock clock;
+            timings_.texels_ = (size_t)output.width_ * output.height_;
+            if (hasContext() && runGL(inputs, n, output))
+            {
+                clock::time_point t0 = clock::now();
+                runGL(inputs, n, output);
+                timings_.gl_ = std::chrono::duration<double>(clock::now() - t0).count();
+            }
+            else
+                timings_.gl_ = 0;
+            clock::time_point t0 = clock::now();
+            runCPU(inputs, n, output);
+            timings_.cpu_ = std::chrono::duration<double>(clock::now() - t0).count();
+            chosen_ = (timings_.gl_ > 0 && timings_.gl_ < timings_.cpu_) ? BACKEND_GL : BACKEND_CPU;
+            return timings_;
+        }
+        void runCPU(const CPU::Dataset* inputs, GLint n, CPU::Dataset& output)
+        {
+            CPU::ThreadPool& pool = pool_ ? *pool_ : CPU::ThreadPool::shared();
+            n = std::min<GLint>(n, CPU::MAX_INPUTS);
+            pool.parallelFor(output.height_, 1, [&](size_t begin, size_t end) {
+                CPU::Span span;
+                span.x_ = 0;
+                span.count_ = output.width_;
+                span.channels_ = output.channels_;
+                span.src_ = inputs;
+                span.inputs_ = n;
+                for (size_t y = begin; y < end; ++y)
+                {
+                    span.y_ = (GLint)y;
+                    for (GLint i = 0; i < n; ++i)
+                        span.in_[i] = inputs[i].row(span.y_);
+                    span.out_ = output.row(span.y_);
+                    cpu_(span);
+                }
+            });
+        }
+        /// the context should be current, false when the program can not be built.
+        bool runGL(const CPU::Dataset* inputs, GLint n, CPU::Dataset& output)
+        {
+            n = std::min<GLint>(n, CPU::MAX_INPUTS);
+            if (!program_.program_ && !build(n))
+                return false;
+            for (GLint i = 0; i < n; ++i)
+            {
+                images_[i].ensure(i);
+                images_[i].setGP();
+                images_[i].template allocFormat<_Fmt>(inputs[i].width_, inputs[i].height_);
+                images_[i].template copyFromFloatMemory<_Fmt>(0, 0, inputs[i].width_, inputs[i].height_, inputs[i].data_);
+            }
+            output_.ensure(n);
+            output_.setGP();
+            output_.template allocFormat<_Fmt>(output.width_, output.height_);
+
+            /// the inputs stay bound to the units 0 .. n-1
+            launcher_.launch(program_, output_, output.width_, output.height_);
+            output_.ensure(n);
+            output_.template copyToFloatMemory<_Fmt>(output.data_);
+            return true;
+        }
+    private:
+        static bool hasContext()
+        {
+            return glGetString(GL_VERSION) != 0;
+        }
+        bool build(GLint n)
+        {
+            std::string fs = "#version 330 core\n";
+            for (GLint i = 0; i < n; ++i)
+                fs.append("uniform ").append(GpuImage2D::glslType()).append(" uIn").append(1, (char)('0' + i)).append(";\n");
+            fs.append("out vec4 fragColor;\n");
+            fs.append(glsl_);
+            fs.append("\nvoid main() {\n    fragColor = kernel(ivec2(gl_FragCoord.xy));\n}\n");
+            if (!GpuLauncher::build(program_, fs.c_str()))
+                return false;
+            program_.ensure();
+            for (GLint i = 0; i < n; ++i)
+            {
+                char name[8] = "uIn0";
+                name[3] = (char)('0' + i);
+                program_.setUniform1i(name, i);
+            }
+            program_.leave();
+            return true;
+        }
+    };
+}; // NS GL3
+}; // NS zhelper
+
+#endif // __ZHELPER_CPU_H_
@@ -0,0 +1,454 @@
+/**
+MIT License
+
+Copyright (c) 2022-2024 bbqz007 <https://github.com/bbqz007, http://www.cnblogs.com/bbqzsl>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __ZHELPER_EGL_H_
+#define __ZHELPER_EGL_H_
+
+#if !defined(__ZHELPER_GL2_H_) && !defined(__ZHELPER_GLES2_H_)
+#error "include zgl_helper.h or zes_helper.h before zegl_helper.h"
+#endif
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#ifdef FEATURE_ZHELPER_USE_OSMESA
+#include <vector>
+#include <GL/osmesa.h>
+#endif // FEATURE_ZHELPER_USE_OSMESA
+
+/// Z#20261019 Design
+///  zgl_helper.h and zes_helper.h assume a context has been current on the calling thread.
+///  this header makes one without any window, for batch workers on servers.
+///
+/// 1. display, the first one available of
+/// 1.a EGL_MESA_platform_surfaceless, mesa (llvmpipe, or the render node of a gpu).
+/// 1.b EGL_EXT_platform_device, the first device, nvidia.
+/// 1.c eglGetDisplay(EGL_DEFAULT_DISPLAY).
+/// 2. context is current without surface (EGL_KHR_surfaceless_context).
+/// 2.a otherwise a 1x1 pbuffer is made, but you should never draw to it, draw to FBO.
+/// 3. desktop GL core/compatibility or GLES3, the same GpuContext.
+/// 4. one context per worker thread.
+/// 4.a createShared() makes a context in the same share group,
+///     buffers, textures, programs are shared. FBOs and VAOs are NOT shared, they are containers.
+/// 4.b a context can be current on only one thread at the same time.
+/// 4.c llvmpipe starts LP_NUM_THREADS rasterizer threads for every context,
+///     set LP_NUM_THREADS=1 or 2 when you scale contexts across cores.
+/// 5. GLEW, call glewInit() after the first makeCurrent(), GLEW should be built with EGL.
+/// 5.a GpuContextInfo::query() resolves glGetStringi by the loader of the context (eglGetProcAddress),
+///     the function pointers of GLEW are null before glewInit().
+///
+/// OSMesa
+/// 1. define FEATURE_ZHELPER_USE_OSMESA, link -lOSMesa.
+/// 2. OSMesa::GpuContext has the same interface. it needs a cpu color buffer, it is 1x1.
+
+namespace zhelper
+{
+namespace EGL
+{
+    /// which namespace of zhelper fits the context
+    enum GpuFeatureSet
+    {
+        FEATURE_NONE = 0,
+        FEATURE_GL2,    /// GL2, fixed pipeline
+        FEATURE_GL3,    /// GL3, gpgpu (Vertex-Fragment)
+        FEATURE_GL4,    /// GL4, gpgpu (Compute), GL4.3 at least. otherwise define HAS_NO_COMPUTE_SHADER
+        FEATURE_GLES3,  /// GLES3
+        FEATURE_GLES31, /// GLES3 with compute shader
+    };
+
+    /// the facts of the current context, query after makeCurrent()
+    struct GpuContextInfo
+    {
+        bool es_ = false;
+        GLint major_ = 0;
+        GLint minor_ = 0;
+        std::string version_;
+        std::string renderer_;
+        std::string extensions_;  /// ' ' separated, with a tailing ' '
+
+        /// getProc is eglGetProcAddress or OSMesaGetProcAddress
+        template<typename _GetProc>
+        void query(_GetProc getProc)
+        {
+            typedef const GLubyte* (KHRONOS_APIENTRY *_PfnGetStringi)(GLenum, GLuint);
+            _PfnGetStringi getStringi = (_PfnGetStringi)getProc("glGetStringi");
+            const char* version = (const char*)glGetString(GL_VERSION);
+            const char* renderer = (const char*)glGetString(GL_RENDERER);
+            version_ = version ? version : "";
+            renderer_ = renderer ? renderer : "";
+            /// "OpenGL ES 3.1 Mesa 22.3.6" or "4.5 (Compatibility Profile) Mesa 22.3.6"
+            const char* prefix = "OpenGL ES ";
+            es_ = (0 == version_.compare(0, strlen(prefix), prefix));
+            major_ = minor_ = 0;
+            sscanf(version_.c_str() + (es_ ? strlen(prefix) : 0), "%d.%d", &major_, &minor_);
+            extensions_.clear();
+            if (major_ >= 3 && getStringi)
+            {
+                GLint n = 0;
+                glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+                for (GLint i = 0; i < n; ++i)
+                {
+                    const char* ext = (const char*)getStringi(GL_EXTENSIONS, i);
+                    if (ext)
+                        extensions_.append(ext).append(1, ' ');
+                }
+            }
+            else
+            {
+                const char* ext = (const char*)glGetString(GL_EXTENSIONS);
+                if (ext)
+                    extensions_.append(ext).append(1, ' ');
+            }
+        }
+        bool hasExtension(const char* name) const
+        {
+            std::string key(name);
+            key.append(1, ' ');
+            size_t pos = extensions_.find(key);
+            /// make sure GL_ARB_foo does not match GL_ARB_foo_bar
+            while (pos != std::string::npos && pos != 0 && extensions_[pos - 1] != ' ')
+                pos = extensions_.find(key, pos + 1);
+            return pos != std::string::npos;
+        }
+        bool atLeast(GLint major, GLint minor) const
+        {
+            return major_ > major || (major_ == major && minor_ >= minor);
+        }
+        GpuFeatureSet featureSet() const
+        {
+            if (!major_)
+                return FEATURE_NONE;
+            if (es_)
+                return atLeast(3, 1) ? FEATURE_GLES31 : (atLeast(3, 0) ? FEATURE_GLES3 : FEATURE_NONE);
+            if (atLeast(4, 3))
+                return FEATURE_GL4;
+            if (atLeast(3, 0))
+                return FEATURE_GL3;
+            return atLeast(2, 0) ? FEATURE_GL2 : FEATURE_NONE;
+        }
+    };
+
+    /// process wide EGLDisplay, initialized once.
+    struct GpuDisplay
+    {
+        EGLDisplay dpy_ = EGL_NO_DISPLAY;
+        EGLint major_ = 0;
+        EGLint minor_ = 0;
+        bool surfaceless_ = false;
+        bool noConfig_ = false;
+        bool createContext_ = false;
+
+        static GpuDisplay& instance()
+        {
+            /// C++11 makes the initialization thread safe
+            static GpuDisplay display;
+            return display;
+        }
+        static bool hasExtension(EGLDisplay dpy, const char* name)
+        {
+            const char* exts = eglQueryString(dpy, EGL_EXTENSIONS);
+            if (!exts)
+                return false;
+            size_t len = strlen(name);
+            for (const char* p = strstr(exts, name); p; p = strstr(p + len, name))
+            {
+                if ((p == exts || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0'))
+                    return true;
+            }
+            return false;
+        }
+        bool available() const
+        {
+            return dpy_ != EGL_NO_DISPLAY;
+        }
+    private:
+        GpuDisplay()
+        {
+            /// client extensions, EGL_NO_DISPLAY is legal since EGL 1.5 or EGL_EXT_client_extensions
+            PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+                (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+            if (getPlatformDisplay && hasExtension(EGL_NO_DISPLAY, "EGL_MESA_platform_surfaceless"))
+                tryInitialize(getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, 0));
+            if (!available() && getPlatformDisplay && hasExtension(EGL_NO_DISPLAY, "EGL_EXT_platform_device"))
+            {
+                PFNEGLQUERYDEVICESEXTPROC queryDevices =
+                    (PFNEGLQUERYDEVICESEXTPROC)eglGetProcAddress("eglQueryDevicesEXT");
+                EGLDeviceEXT device;
+                EGLint n = 0;
+                if (queryDevices && queryDevices(1, &device, &n) && n > 0)
+                    tryInitialize(getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, device, 0));
+            }
+            if (!available())
+                tryInitialize(eglGetDisplay(EGL_DEFAULT_DISPLAY));
+            if (available())
+            {
+                surfaceless_ = hasExtension(dpy_, "EGL_KHR_surfaceless_context");
+                noConfig_ = hasExtension(dpy_, "EGL_KHR_no_config_context") || hasExtension(dpy_, "EGL_MESA_configless_context");
+                createContext_ = hasExtension(dpy_, "EGL_KHR_create_context") || major_ > 1 || minor_ >= 5;
+            }
+        }
+        ~GpuDisplay()
+        {
+            if (available())
+                eglTerminate(dpy_);
+        }
+        void tryInitialize(EGLDisplay dpy)
+        {
+            if (dpy != EGL_NO_DISPLAY && eglInitialize(dpy, &major_, &minor_))
+                dpy_ = dpy;
+        }
+    };
+
+    struct GpuContext
+    {
+        EGLDisplay dpy_ = EGL_NO_DISPLAY;
+        EGLContext ctx_ = EGL_NO_CONTEXT;
+        EGLSurface surface_ = EGL_NO_SURFACE;
+        EGLConfig config_ = 0;
+        GLint major_ = 0;
+        GLint minor_ = 0;
+        bool es_ = false;
+        bool core_ = false;
+        GpuContextInfo info_;
+
+        ~GpuContext()
+        {
+            destroy();
+        }
+        /// desktop GL, core profile for GL3.2 or later by default.
+        bool createGL(GLint major = 4, GLint minor = 5, bool core = true, const GpuContext* share = 0)
+        {
+            return create(false, major, minor, core, share);
+        }
+        bool createGLES(GLint major = 3, GLint minor = 0, const GpuContext* share = 0)
+        {
+            return create(true, major, minor, false, share);
+        }
+        /// the same api, version and profile as the root, in its share group.
+        bool createShared(const GpuContext& root)
+        {
+            return create(root.es_, root.major_, root.minor_, root.core_, &root);
+        }
+        bool create(bool es, GLint major, GLint minor, bool core, const GpuContext* share = 0)
+        {
+            destroy();
+            GpuDisplay& display = GpuDisplay::instance();
+            if (!display.available())
+                return false;
+            dpy_ = display.dpy_;
+            config_ = 0;
+            es_ = es;
+            major_ = major;
+            minor_ = minor;
+            core_ = core && !es && (major > 3 || (major == 3 && minor >= 2));
+            if (!eglBindAPI(es ? EGL_OPENGL_ES_API : EGL_OPENGL_API))
+                return false;
+
+            /// a config is still needed for pbuffer, or when configless is not supported.
+            /// shared contexts must have compatible configs, so keep the root's.
+            if (share && share->config_)
+                config_ = share->config_;
+            else if (!display.noConfig_ || !display.surfaceless_)
+            {
+                EGLint attrs[] = {
+                    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                    EGL_RENDERABLE_TYPE, es ? ((major >= 3) ? EGL_OPENGL_ES3_BIT_KHR : EGL_OPENGL_ES2_BIT) : EGL_OPENGL_BIT,
+                    EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+                    EGL_NONE
+                };
+                EGLint n = 0;
+                if (!eglChooseConfig(dpy_, attrs, &config_, 1, &n) || n < 1)
+                    return false;
+            }
+
+            EGLint attrs[16];
+            int i = 0;
+            if (display.createContext_)
+            {
+                attrs[i++] = EGL_CONTEXT_MAJOR_VERSION_KHR;
+                attrs[i++] = major;
+                attrs[i++] = EGL_CONTEXT_MINOR_VERSION_KHR;
+                attrs[i++] = minor;
+                if (!es)
+                {
+                    attrs[i++] = EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR;
+                    attrs[i++] = core_ ? EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR : EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT_KHR;
+                }
+            }
+            else if (es)
+            {
+                attrs[i++] = EGL_CONTEXT_CLIENT_VERSION;
+                attrs[i++] = major;
+            }
+            attrs[i++] = EGL_NONE;
+            ctx_ = eglCreateContext(dpy_, config_ ? config_ : (EGLConfig)0, share ? share->ctx_ : EGL_NO_CONTEXT, attrs);
+            if (ctx_ == EGL_NO_CONTEXT)
+                return false;
+            if (!display.surfaceless_)
+            {
+                EGLint pbattrs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+                surface_ = eglCreatePbufferSurface(dpy_, config_, pbattrs);
+                if (surface_ == EGL_NO_SURFACE)
+                {
+                    destroy();
+                    return false;
+                }
+            }
+            return true;
+        }
+        void destroy()
+        {
+            if (ctx_ != EGL_NO_CONTEXT)
+            {
+                if (eglGetCurrentContext() == ctx_)
+                    release();
+                eglDestroyContext(dpy_, ctx_);
+            }
+            if (surface_ != EGL_NO_SURFACE)
+                eglDestroySurface(dpy_, surface_);
+            ctx_ = EGL_NO_CONTEXT;
+            surface_ = EGL_NO_SURFACE;
+        }
+        bool available() const
+        {
+            return ctx_ != EGL_NO_CONTEXT;
+        }
+        /// the first makeCurrent() queries the version and extensions.
+        bool makeCurrent()
+        {
+            if (!available())
+                return false;
+            /// the api bound is per thread
+            eglBindAPI(es_ ? EGL_OPENGL_ES_API : EGL_OPENGL_API);
+            if (!eglMakeCurrent(dpy_, surface_, surface_, ctx_))
+                return false;
+            if (!info_.major_)
+                info_.query(eglGetProcAddress);
+            return true;
+        }
+        void release()
+        {
+            eglMakeCurrent(dpy_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        }
+        const GpuContextInfo& info() const
+        {
+            return info_;
+        }
+        GpuFeatureSet featureSet() const
+        {
+            return info_.featureSet();
+        }
+        bool hasExtension(const char* name) const
+        {
+            return info_.hasExtension(name);
+        }
+    };
+}; // NS EGL
+}; // NS zhelper
+
+#ifdef FEATURE_ZHELPER_USE_OSMESA
+namespace zhelper
+{
+namespace OSMesa
+{
+    typedef EGL::GpuFeatureSet GpuFeatureSet;
+    typedef EGL::GpuContextInfo GpuContextInfo;
+
+    struct GpuContext
+    {
+        OSMesaContext ctx_ = 0;
+        std::vector<GLubyte> buffer_;
+        GLint major_ = 0;
+        GLint minor_ = 0;
+        bool core_ = false;
+        GpuContextInfo info_;
+
+        ~GpuContext()
+        {
+            destroy();
+        }
+        bool createGL(GLint major = 4, GLint minor = 5, bool core = true, const GpuContext* share = 0)
+        {
+            destroy();
+            major_ = major;
+            minor_ = minor;
+            core_ = core && (major > 3 || (major == 3 && minor >= 2));
+            const int attrs[] = {
+                OSMESA_FORMAT, OSMESA_RGBA,
+                OSMESA_DEPTH_BITS, 0,
+                OSMESA_PROFILE, core_ ? OSMESA_CORE_PROFILE : OSMESA_COMPAT_PROFILE,
+                OSMESA_CONTEXT_MAJOR_VERSION, major,
+                OSMESA_CONTEXT_MINOR_VERSION, minor,
+                0
+            };
+            ctx_ = OSMesaCreateContextAttribs(attrs, share ? share->ctx_ : 0);
+            buffer_.resize(4);
+            return ctx_ != 0;
+        }
+        bool createShared(const GpuContext& root)
+        {
+            return createGL(root.major_, root.minor_, root.core_, &root);
+        }
+        void destroy()
+        {
+            if (ctx_)
+                OSMesaDestroyContext(ctx_);
+            ctx_ = 0;
+        }
+        bool available() const
+        {
+            return ctx_ != 0;
+        }
+        bool makeCurrent()
+        {
+            if (!available() || !OSMesaMakeCurrent(ctx_, buffer_.data(), GL_UNSIGNED_BYTE, 1, 1))
+                return false;
+            if (!info_.major_)
+                info_.query(OSMesaGetProcAddress);
+            return true;
+        }
+        void release()
+        {
+            OSMesaMakeCurrent(0, 0, 0, 0, 0);
+        }
+        const GpuContextInfo& info() const
+        {
+            return info_;
+        }
+        GpuFeatureSet featureSet() const
+        {
+            return info_.featureSet();
+        }
+        bool hasExtension(const char* name) const
+        {
+            return info_.hasExtension(name);
+        }
+    };
+}; // NS OSMesa
+}; // NS zhelper
+#endif // FEATURE_ZHELPER_USE_OSMESA
+
+#endif // __ZHELPER_EGL_H_
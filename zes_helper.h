@@ -27,7 +27,20 @@ SOFTWARE.
 #define GL_GLES_PROTOTYPES 1
 #define GL_GLEXT_PROTOTYPES 1
 #define FEATURE_USE_ANGLE
+/// Z#20261019 define FEATURE_ZHELPER_GLES31 for compute, FEATURE_ZHELPER_GLES32 for GL_TEXTURE_BUFFER too
+#ifdef FEATURE_ZHELPER_GLES32
+#ifndef FEATURE_ZHELPER_GLES31
+#define FEATURE_ZHELPER_GLES31
+#endif // FEATURE_ZHELPER_GLES31
+#include <GLES3/gl32.h>
+#elif defined(FEATURE_ZHELPER_GLES31)
+#include <GLES3/gl31.h>
+#else
 #include <GLES3/gl3.h>
+#endif // FEATURE_ZHELPER_GLES32
+#include <algorithm>
+#include <cstring>
+#include <string>
 
 
 /// Z#20220419
@@ -68,6 +81,28 @@ namespace GLES2
         }
     };
     
+    /// Z#20261019 ES 3.0 PBO, pack is gpu to cpu, unpack is cpu to gpu
+    template<>
+    struct _Traits_GpuBuffer<GL_PIXEL_PACK_BUFFER>
+    {
+        static int queryCurrentBinding()
+        {
+            GLint vbo = 0;
+            glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &vbo);
+            return vbo;
+        }
+    };
+    template<>
+    struct _Traits_GpuBuffer<GL_PIXEL_UNPACK_BUFFER>
+    {
+        static int queryCurrentBinding()
+        {
+            GLint vbo = 0;
+            glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &vbo);
+            return vbo;
+        }
+    };
+    
     template<GLenum _Ty, bool _AutoRelease = true, typename _Traits = _Traits_GpuBuffer<_Ty> >
     struct GpuBuffer
     {
@@ -300,7 +335,9 @@ namespace GLES2
         ~GpuFBODevice()
         {
             leave();
-            if (!fbo_)
+            /// Z#20261019 bug
+            ///  it was `if (!fbo_)`, every FBO leaked.
+            if (fbo_)
                 glDeleteFramebuffers(1, &fbo_);
             fbo_ = 0;
         }
@@ -383,6 +420,35 @@ namespace GLES3
         {
             GLES2::GpuImage2D::alloc(internalFormat, width, height, border, format, type, data);
         }
+        /// Z#20261019 PBO transfers, the same as GL2::GpuImage2D of zgl_helper.h
+        template<GLint _Lv = 0>
+        void copyFromGpuPixelBufferDrawable(GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+                   GLenum format, GLenum type, const GLvoid* offset = 0)
+        {
+            if (GLES2::_Traits_GpuBuffer<GL_PIXEL_UNPACK_BUFFER>::queryCurrentBinding())
+                glTexSubImage2D(GL_TEXTURE_2D, _Lv, xoffset, yoffset, width, height, format, type, offset);
+        }
+        void copyToGpuPixelBufferReadable(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid* offset = 0)
+        {
+            /// depend to FBO and PBO (pack)
+            /// you should GpuFBODevice::openReadCurrentFBO() first
+            /// and GpuPixelBufferReadable::ensure() 
+            if (GLES2::_Traits_GpuBuffer<GL_PIXEL_PACK_BUFFER>::queryCurrentBinding())
+                glReadPixels(x, y, width, height, format, type, offset);
+        }
+#ifdef FEATURE_ZHELPER_GLES31
+        /// Z#20261019 the image unit of `image2D` in the compute shader, layout(binding = unit, format)
+        ///  format is the sized internal format of alloc(), access GL_READ_ONLY, GL_WRITE_ONLY or GL_READ_WRITE
+        ///  ES 3.1 allows GL_READ_WRITE only for r32f, r32i and r32ui
+        void bindImage(GLuint unit, GLenum access, GLenum format, GLint level = 0)
+        {
+            glBindImageTexture(unit, tex_, level, GL_FALSE, 0, access, format);
+        }
+        static void unbindImage(GLuint unit)
+        {
+            glBindImageTexture(unit, 0, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+        }
+#endif // FEATURE_ZHELPER_GLES31
     };
     
     typedef GLES2::GpuRenderDevice GpuRenderDevice;
@@ -392,6 +458,640 @@ namespace GLES3
     {
     };
     
+    /// Z#20261019
+    ///  ES has no glMapBuffer, glGetBufferSubData nor glGetTexImage.
+    ///  so every readback was a glReadPixels to the cpu memory, the thread waits for the gpu.
+    ///  ES 3.0 has glMapBufferRange, PBO and fences, the transfers of GL3 are rebuilt on them.
+    /// 1. GpuBuffer keeps the size of alloc(), mmap() maps the whole buffer by glMapBufferRange.
+    /// 2. copyTo() maps for read, there is no glGetBufferSubData.
+    /// 3. GpuPixelBufferReadable/Drawable and the savers are the same as GL2 of zgl_helper.h.
+    /// 4. GpuReadback, async readback to a staging PBO plus a fence, as GL3::GpuReadback.
+    ///    issuePixels() is glReadPixels from the current read FBO, there is no glGetTexImage.
+    ///    a failed wait, map or unmap is kept by failed(), ready() and wait() return false until the next issue.
+    /// 5. GpuBufferImage
+    /// 5.a FEATURE_ZHELPER_GLES32, GL_TEXTURE_BUFFER of ES 3.2, a samplerBuffer.
+    /// 5.b otherwise a GL_TEXTURE_2D of rows, width is min(texels, GL_MAX_TEXTURE_SIZE).
+    ///     the texels are kept in a PBO, copyFromCpuMemory() writes the PBO and
+    ///     the rows covered are copied to the texture by the gpu (glTexSubImage2D from the PBO).
+    /// 5.c glslFetch() defines texelFetchBuffer(s, i) for both, the kernel is the same.
+    template<GLenum _Ty, bool _AutoRelease = true, typename _Traits = GLES2::_Traits_GpuBuffer<_Ty> >
+    struct GpuBuffer : public GLES2::GpuBuffer<_Ty, _AutoRelease, _Traits>
+    {
+        typedef GLES2::GpuBuffer<_Ty, _AutoRelease, _Traits> base_type;
+        GLsizeiptr size_ = 0;
+        
+        static int queryCurrentBinding()
+        {
+            return _Traits::queryCurrentBinding();
+        }
+        void alloc(GLsizeiptr size, GLenum usage)
+        {
+            base_type::alloc(size, usage);
+            size_ = size;
+        }
+        void alloc(GLsizeiptr size, const GLvoid* data, GLenum usage)
+        {
+            base_type::alloc(size, data, usage);
+            size_ = size;
+        }
+        void copyTo(GLintptr offset, GLsizeiptr size, GLvoid* data)
+        {
+            void* vaddr = mmapRange(offset, size, GL_MAP_READ_BIT);
+            if (!vaddr)
+                return;
+            memcpy(data, vaddr, size);
+            unmap();
+        }
+        void* mmapReadOnly()
+        {
+            return mmapRange(0, size_, GL_MAP_READ_BIT);
+        }
+        void* mmapWriteOnly()
+        {
+            return mmapRange(0, size_, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        }
+        void* mmapReadWrite()
+        {
+            return mmapRange(0, size_, GL_MAP_READ_BIT | GL_MAP_WRITE_BIT);
+        }
+        bool unmap()
+        {
+            return glUnmapBuffer(_Ty);
+        }
+        void* mmapRange(GLintptr offset, GLsizeiptr size, GLbitfield access)
+        {
+            return glMapBufferRange(_Ty, offset, size, access);
+        }
+        /// with GL_MAP_FLUSH_EXPLICIT_BIT, offset is relative to the mapped range
+        void flushMappedRange(GLintptr offset, GLsizeiptr size)
+        {
+            glFlushMappedBufferRange(_Ty, offset, size);
+        }
+    };
+    
+    struct GpuPixelBufferReadable : public GpuBuffer<GL_PIXEL_PACK_BUFFER>
+    {
+        void alloc(GLsizeiptr size)
+        {
+            GpuBuffer::alloc(size, GL_STATIC_READ);
+        }
+        void allocDynamic(GLsizeiptr size)
+        {
+            GpuBuffer::alloc(size, GL_DYNAMIC_READ);
+        }
+        // alloc has been overloaded 
+        void alloc(GLsizeiptr size, GLenum type)
+        {
+            GpuBuffer::alloc(size, type);
+        }
+        void* mmap()
+        {
+            return mmapReadOnly();
+        }
+    };
+    struct GpuPixelBufferReadableSaver
+    {
+        GLint handle;
+        ~GpuPixelBufferReadableSaver()
+        {
+            if (handle)
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, handle);
+        }
+        GpuPixelBufferReadableSaver() 
+        {
+            handle = GpuPixelBufferReadable::queryCurrentBinding();
+            if (handle)
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+    };
+    
+    struct GpuPixelBufferDrawable : public GpuBuffer<GL_PIXEL_UNPACK_BUFFER>
+    {
+        void alloc(GLsizeiptr size)
+        {
+            GpuBuffer::alloc(size, GL_STATIC_DRAW);
+        }
+        void allocDynamic(GLsizeiptr size)
+        {
+            GpuBuffer::alloc(size, GL_DYNAMIC_DRAW);
+        }
+        // alloc has been overloaded 
+        void alloc(GLsizeiptr size, GLenum type)
+        {
+            GpuBuffer::alloc(size, type);
+        }
+        void* mmap()
+        {
+            return mmapWriteOnly();
+        }
+    };
+    struct GpuPixelBufferDrawableSaver
+    {
+        GLint handle;
+        ~GpuPixelBufferDrawableSaver()
+        {
+            if (handle)
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, handle);
+        }
+        GpuPixelBufferDrawableSaver() 
+        {
+            handle = GpuPixelBufferDrawable::queryCurrentBinding();
+            if (handle)
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+    };
+    
+    /// the texels of sized internal formats, for the PBO transfers of GpuBufferImage
+    struct GpuTexelFormat
+    {
+        GLenum format_ = GL_RGBA;
+        GLenum type_ = GL_UNSIGNED_BYTE;
+        GLsizei bytes_ = 4;
+        
+        explicit GpuTexelFormat(GLint internalFormat)
+        {
+            switch (internalFormat)
+            {
+            case GL_R8:         set(GL_RED, GL_UNSIGNED_BYTE, 1); break;
+            case GL_RG8:        set(GL_RG, GL_UNSIGNED_BYTE, 2); break;
+            case GL_RGBA8:      set(GL_RGBA, GL_UNSIGNED_BYTE, 4); break;
+            case GL_R16F:       set(GL_RED, GL_HALF_FLOAT, 2); break;
+            case GL_RG16F:      set(GL_RG, GL_HALF_FLOAT, 4); break;
+            case GL_RGBA16F:    set(GL_RGBA, GL_HALF_FLOAT, 8); break;
+            case GL_R32F:       set(GL_RED, GL_FLOAT, 4); break;
+            case GL_RG32F:      set(GL_RG, GL_FLOAT, 8); break;
+            case GL_RGBA32F:    set(GL_RGBA, GL_FLOAT, 16); break;
+            case GL_R32I:       set(GL_RED_INTEGER, GL_INT, 4); break;
+            case GL_R32UI:      set(GL_RED_INTEGER, GL_UNSIGNED_INT, 4); break;
+            case GL_RG32I:      set(GL_RG_INTEGER, GL_INT, 8); break;
+            case GL_RG32UI:     set(GL_RG_INTEGER, GL_UNSIGNED_INT, 8); break;
+            case GL_RGBA32I:    set(GL_RGBA_INTEGER, GL_INT, 16); break;
+            case GL_RGBA32UI:   set(GL_RGBA_INTEGER, GL_UNSIGNED_INT, 16); break;
+            default:            break;
+            }
+        }
+    private:
+        void set(GLenum format, GLenum type, GLsizei bytes)
+        {
+            format_ = format;
+            type_ = type;
+            bytes_ = bytes;
+        }
+    };
+    
+    struct GpuReadback
+    {
+        GpuPixelBufferReadable staging_;
+        GLsizeiptr capacity_ = 0;
+        GLsizeiptr bytes_ = 0;
+        GLvoid* data_ = 0;
+        GLsync sync_ = 0;
+        bool failed_ = false;
+        
+        ~GpuReadback()
+        {
+            if (sync_)
+                glDeleteSync(sync_);
+            sync_ = 0;
+        }
+        bool issue(GLuint buffer, GLintptr offset, GLsizeiptr bytes, GLvoid* data)
+        {
+            if (pending() || !reserve(bytes))
+                return false;
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, staging_.vbo_);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, 0, bytes);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            return fence(bytes, data);
+        }
+        /// from the current read FBO, GpuFBODevice::openReadCurrentFBO() first
+        bool issuePixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLsizeiptr bytes, GLvoid* data)
+        {
+            if (pending() || !reserve(bytes))
+                return false;
+            GpuPixelBufferReadableSaver pbo;
+            staging_.ensure();
+            glReadPixels(x, y, width, height, format, type, 0);
+            staging_.leave();
+            return fence(bytes, data);
+        }
+        bool pending() const
+        {
+            return sync_ != 0;
+        }
+        /// the last readback failed, the wait, the map or the unmap, data was not written.
+        ///  kept until the next issue.
+        bool failed() const
+        {
+            return failed_;
+        }
+        /// never blocks. true when the data has been copied to the cpu memory.
+        ///  false while pending, or when it failed, see failed().
+        bool ready()
+        {
+            if (!sync_)
+                return !failed_;
+            GLenum r = glClientWaitSync(sync_, 0, 0);
+            if (r == GL_TIMEOUT_EXPIRED)
+                return false;
+            return complete(r);
+        }
+        /// blocks up to timeout nanoseconds.
+        bool wait(GLuint64 timeout = GL_TIMEOUT_IGNORED)
+        {
+            if (!sync_)
+                return !failed_;
+            GLenum r = glClientWaitSync(sync_, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+            if (r == GL_TIMEOUT_EXPIRED)
+                return false;
+            return complete(r);
+        }
+    private:
+        bool reserve(GLsizeiptr bytes)
+        {
+            if (bytes <= 0)
+                return false;
+            if (bytes <= capacity_)
+                return true;
+            GpuPixelBufferReadableSaver pbo;
+            staging_.ensure();
+            staging_.alloc(bytes, GL_STREAM_READ);
+            staging_.leave();
+            capacity_ = bytes;
+            return true;
+        }
+        bool fence(GLsizeiptr bytes, GLvoid* data)
+        {
+            bytes_ = bytes;
+            data_ = data;
+            sync_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            failed_ = sync_ == 0;
+            /// so ready() alone can see the fence signaled
+            glFlush();
+            return sync_ != 0;
+        }
+        /// Z#20261019 bug
+        ///  a failed wait or map deleted sync_ only, the next ready() or wait() returned true.
+        bool complete(GLenum r)
+        {
+            glDeleteSync(sync_);
+            sync_ = 0;
+            failed_ = true;
+            if (r == GL_WAIT_FAILED)
+                return false;
+            GpuPixelBufferReadableSaver pbo;
+            staging_.ensure();
+            void* vaddr = staging_.mmapRange(0, bytes_, GL_MAP_READ_BIT);
+            if (vaddr)
+            {
+                memcpy(data_, vaddr, bytes_);
+                failed_ = !staging_.unmap();
+            }
+            staging_.leave();
+            return !failed_;
+        }
+    };
+    
+#ifdef FEATURE_ZHELPER_GLES32
+    struct _Traits_GpuTexBuffer
+    {
+        static int queryCurrentBinding()
+        {
+            GLint vbo = 0;
+            glGetIntegerv(GL_TEXTURE_BUFFER_BINDING, &vbo);
+            return vbo;
+        }
+    };
+    
+    struct GpuTexBuffer : public GpuBuffer<GL_TEXTURE_BUFFER, true, _Traits_GpuTexBuffer>
+    {
+        
+    };
+    
+    /// buffer texture can not attach to FBO
+    struct GpuBufferImage : public GLES2::GpuImage<GL_TEXTURE_BUFFER>
+    {
+        GpuTexBuffer self_buf_;
+        
+        /// a buffer of the user, not an alloc() overload, alloc(GL_R32F, 64) would be ambiguous
+        void attach(GLint internalFormat, GLuint buffer)
+        {
+            glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, buffer);
+        }
+        void alloc(GLint internalFormat, GLsizeiptr bytes, GLenum usage = GL_STATIC_DRAW)
+        {
+            self_buf_.ensure();
+            self_buf_.alloc(bytes, usage);
+            attach(internalFormat, self_buf_.vbo_);
+        }
+        void alloc(GLint internalFormat, GLsizeiptr bytes, const GLvoid* data, GLenum usage = GL_STATIC_DRAW)
+        {
+            self_buf_.ensure();
+            self_buf_.alloc(bytes, data, usage);
+            attach(internalFormat, self_buf_.vbo_);
+        }
+        void copyFromCpuMemory(GLintptr offset, GLsizeiptr bytes, const GLvoid* data)
+        {
+            self_buf_.ensure();
+            self_buf_.copy(offset, bytes, data);
+        }
+        void copyToCpuMemory(GLintptr offset, GLsizeiptr bytes, GLvoid* data)
+        {
+            self_buf_.ensure();
+            self_buf_.copyTo(offset, bytes, data);
+        }
+        bool copyToCpuMemoryAsync(GpuReadback& readback, GLintptr offset, GLsizeiptr bytes, GLvoid* data)
+        {
+            return readback.issue(self_buf_.vbo_, offset, bytes, data);
+        }
+        static const char* glslType()
+        {
+            return "highp samplerBuffer";
+        }
+        static const char* glslFetch()
+        {
+            return "#define texelFetchBuffer(s, i) texelFetch(s, i)\n";
+        }
+    };
+#else
+    struct GpuBufferImage : public GpuImage2D
+    {
+        GpuPixelBufferDrawable self_buf_;
+        GLint internalFormat_ = 0;
+        GLsizei width_ = 0;
+        GLsizei height_ = 0;
+        GLsizei texelBytes_ = 0;
+        
+        void alloc(GLint internalFormat, GLsizeiptr bytes, GLenum usage = GL_STATIC_DRAW)
+        {
+            alloc(internalFormat, bytes, 0, usage);
+        }
+        /// the texture is bound to the current unit
+        void alloc(GLint internalFormat, GLsizeiptr bytes, const GLvoid* data, GLenum usage = GL_STATIC_DRAW)
+        {
+            GpuTexelFormat texel(internalFormat);
+            GLint maxWidth = 0;
+            glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxWidth);
+            GLsizeiptr texels = (bytes + texel.bytes_ - 1) / texel.bytes_;
+            internalFormat_ = internalFormat;
+            texelBytes_ = texel.bytes_;
+            width_ = (GLsizei)std::min<GLsizeiptr>(std::max<GLsizeiptr>(texels, 1), maxWidth);
+            height_ = (GLsizei)((texels + width_ - 1) / width_);
+            GpuImage2D::ensure();
+            setGP();
+            GpuImage2D::alloc(internalFormat, width_, height_);
+            GpuPixelBufferDrawableSaver pbo;
+            self_buf_.ensure();
+            /// whole rows, the tail of the last row is padding
+            self_buf_.alloc((GLsizeiptr)width_ * height_ * texelBytes_, usage);
+            if (data)
+            {
+                self_buf_.copy(0, bytes, data);
+                upload(0, height_);
+            }
+            self_buf_.leave();
+        }
+        void copyFromCpuMemory(GLintptr offset, GLsizeiptr bytes, const GLvoid* data)
+        {
+            if (bytes <= 0)
+                return;
+            GpuPixelBufferDrawableSaver pbo;
+            self_buf_.ensure();
+            self_buf_.copy(offset, bytes, data);
+            GLsizeiptr row = (GLsizeiptr)width_ * texelBytes_;
+            GpuImage2D::ensure();
+            upload((GLint)(offset / row), (GLint)((offset + bytes - 1) / row) + 1);
+            self_buf_.leave();
+        }
+        void copyToCpuMemory(GLintptr offset, GLsizeiptr bytes, GLvoid* data)
+        {
+            GpuPixelBufferDrawableSaver pbo;
+            self_buf_.ensure();
+            self_buf_.copyTo(offset, bytes, data);
+            self_buf_.leave();
+        }
+        bool copyToCpuMemoryAsync(GpuReadback& readback, GLintptr offset, GLsizeiptr bytes, GLvoid* data)
+        {
+            return readback.issue(self_buf_.vbo_, offset, bytes, data);
+        }
+        static const char* glslType()
+        {
+            return "highp sampler2D";
+        }
+        static const char* glslFetch()
+        {
+            return "#define texelFetchBuffer(s, i) texelFetch(s, ivec2((i) % textureSize(s, 0).x, (i) / textureSize(s, 0).x), 0)\n";
+        }
+    private:
+        /// rows [first, last) from the PBO, both bound
+        void upload(GLint first, GLint last)
+        {
+            GpuTexelFormat texel(internalFormat_);
+            GLint alignment = 4;
+            glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, first, width_, last - first, texel.format_, texel.type_,
+                            (const GLvoid*)((GLsizeiptr)first * width_ * texelBytes_));
+            glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+        }
+    };
+#endif // FEATURE_ZHELPER_GLES32
+    
+#ifdef FEATURE_ZHELPER_GLES31
+    /// Z#20261019
+    ///  ES draws to GL_COLOR_ATTACHMENT0 only (no glBindFragDataLocation, no layout(index)),
+    ///  every output of a fragment kernel on ES is a pass, ES 3.1 compute writes many images and SSBOs in one dispatch.
+    /// 1. GpuShaderStorageBuffer, std430 blocks, bindBase()/bindRange() to layout(binding = index).
+    /// 2. GpuImage2D::bindImage(), the image units, the texture must be immutable (glTexStorage2D).
+    /// 3. GpuComputeProgram, build, local_size from the program, dispatch() for a grid of work items.
+    /// 4. GpuMemoryBarrier, writes of a dispatch are incoherent,
+    ///    the barrier names how the next commands read them, not who wrote them.
+    /// LIMIT: ES 3.1 guarantees 4 image units and 4 SSBOs to the compute stage only, 0 to the fragment stage.
+    struct _Traits_GpuShaderStorageBuffer
+    {
+        static int queryCurrentBinding()
+        {
+            GLint vbo = 0;
+            glGetIntegerv(GL_SHADER_STORAGE_BUFFER_BINDING, &vbo);
+            return vbo;
+        }
+        static GLint offsetAlignment()
+        {
+            GLint align = 256;
+            glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &align);
+            return align;
+        }
+    };
+    
+    struct GpuShaderStorageBuffer : public GpuBuffer<GL_SHADER_STORAGE_BUFFER, true, _Traits_GpuShaderStorageBuffer>
+    {
+        /// the binding point `index` of the block, layout(std430, binding = index)
+        void bindBase(GLuint index)
+        {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, index, vbo_);
+        }
+        /// offset is a multiple of _Traits_GpuShaderStorageBuffer::offsetAlignment()
+        void bindRange(GLuint index, GLintptr offset, GLsizeiptr size)
+        {
+            glBindBufferRange(GL_SHADER_STORAGE_BUFFER, index, vbo_, offset, size);
+        }
+    };
+    
+    struct GpuMemoryBarrier
+    {
+        /// imageLoad() of the next dispatch
+        static void forImage()
+        {
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        }
+        /// texture() or texelFetch() of the next draw or dispatch
+        static void forSampler()
+        {
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        }
+        /// the SSBO of the next dispatch
+        static void forStorage()
+        {
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        }
+        /// glMapBufferRange, glReadPixels to a PBO, glTexSubImage2D, or GpuReadback
+        static void forCpu()
+        {
+            glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+        }
+        /// the SSBO as vertices or indices of the next draw
+        static void forVertex()
+        {
+            glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT);
+        }
+        static void all()
+        {
+            glMemoryBarrier(GL_ALL_BARRIER_BITS);
+        }
+    };
+    
+    struct GpuComputeProgram
+    {
+        GLuint program_ = 0;
+        GLint localSize_[3] = {1, 1, 1};
+        std::string log_;
+        
+        ~GpuComputeProgram()
+        {
+            if (program_)
+                glDeleteProgram(program_);
+            program_ = 0;
+        }
+        bool available()
+        {
+            return program_ && glIsProgram(program_);
+        }
+        void ensure()
+        {
+            glUseProgram(program_);
+        }
+        void leave()
+        {
+            GLint program = 0;
+            glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+            if ((GLuint)program == program_)
+                glUseProgram(0);
+        }
+        /// "#version 310 es" and layout(local_size_x = , local_size_y = ) in;
+        bool build(const char* computeSource)
+        {
+            log_.clear();
+            if (program_)
+                glDeleteProgram(program_);
+            program_ = 0;
+            GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+            glShaderSource(shader, 1, &computeSource, 0);
+            glCompileShader(shader);
+            GLint status = 0;
+            glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+            if (!status)
+            {
+                appendLog(shader, false);
+                glDeleteShader(shader);
+                return false;
+            }
+            program_ = glCreateProgram();
+            glAttachShader(program_, shader);
+            glLinkProgram(program_);
+            /// flagged, deleted with the program
+            glDeleteShader(shader);
+            glGetProgramiv(program_, GL_LINK_STATUS, &status);
+            if (!status)
+            {
+                appendLog(program_, true);
+                glDeleteProgram(program_);
+                program_ = 0;
+                return false;
+            }
+            glGetProgramiv(program_, GL_COMPUTE_WORK_GROUP_SIZE, localSize_);
+            return true;
+        }
+        GLint uniform(const char* name)
+        {
+            return glGetUniformLocation(program_, name);
+        }
+        /// the program should be ensured
+        void setUniform1i(const char* name, GLint v)
+        {
+            glUniform1i(uniform(name), v);
+        }
+        void setUniform1f(const char* name, GLfloat v)
+        {
+            glUniform1f(uniform(name), v);
+        }
+        void setUniform2i(const char* name, GLint x, GLint y)
+        {
+            glUniform2i(uniform(name), x, y);
+        }
+        void setUniform4fv(const char* name, const GLfloat* v4f)
+        {
+            glUniform4fv(uniform(name), 1, v4f);
+        }
+        /// groups, not work items
+        void dispatchGroups(GLuint x, GLuint y = 1, GLuint z = 1)
+        {
+            glDispatchCompute(x, y, z);
+        }
+        /// work items, rounded up to whole groups, the kernel returns when gl_GlobalInvocationID is out of the grid
+        void dispatch(GLuint width, GLuint height = 1, GLuint depth = 1)
+        {
+            glDispatchCompute((width + localSize_[0] - 1) / localSize_[0],
+                              (height + localSize_[1] - 1) / localSize_[1],
+                              (depth + localSize_[2] - 1) / localSize_[2]);
+        }
+        /// the group counts are 3 GLuint at offset of the GL_DISPATCH_INDIRECT_BUFFER, written by an earlier dispatch
+        void dispatchIndirect(GLuint buffer, GLintptr offset = 0)
+        {
+            glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, buffer);
+            glDispatchComputeIndirect(offset);
+            glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+        }
+    private:
+        void appendLog(GLuint object, bool program)
+        {
+            GLint len = 0;
+            if (program)
+                glGetProgramiv(object, GL_INFO_LOG_LENGTH, &len);
+            else
+                glGetShaderiv(object, GL_INFO_LOG_LENGTH, &len);
+            if (len <= 0)
+                return;
+            std::string log(len, '\0');
+            if (program)
+                glGetProgramInfoLog(object, len, 0, &log[0]);
+            else
+                glGetShaderInfoLog(object, len, 0, &log[0]);
+            log_.append(log.c_str());
+        }
+    };
+#endif // FEATURE_ZHELPER_GLES31
+    
 }; // NS GLES3
 }; // NS zhelper
 
@@ -0,0 +1,352 @@
+/**
+MIT License
+
+Copyright (c) 2022-2024 bbqz007 <https://github.com/bbqz007, http://www.cnblogs.com/bbqzsl>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __ZHELPER_EXPR_H_
+#define __ZHELPER_EXPR_H_
+
+#include "zgl_helper.h"
+#include <map>
+#include <memory>
+
+/// Z#20261019 Design
+///  scale, clamp, log, compare, ... as one pass each, every pass reads and writes the whole image.
+///  an expression of C++ is generated to one fragment shader, one read of each input, one write.
+///
+///     using namespace zhelper::GL3::expr;
+///     Input<0> a;
+///     Input<1, GpuImageRect> b;
+///     kernel.run(select(log(a * 2.0f) > b, clamp(a, 0.0f, 1.0f), 0.0f), out, w, h, imageA, imageB);
+///
+/// 1. every value is vec4, the inputs are fetched once at gl_FragCoord.xy.
+/// 2. the sampler of Input<N, _Img> is declared by _Img::glslType(),
+///    GpuImage2D, GpuImageRect, GpuBufferImage (row major, by the width of the output).
+/// 3. constants are the uniform uC[], not literals, so `a * 2.0f` and `a * 3.0f` is one program.
+/// 4. the generated source is the signature, programs are cached by it.
+/// 5. fragment shader, not compute, see the attentions in README.
+
+namespace zhelper
+{
+namespace GL3
+{
+namespace expr
+{
+    template<typename _Img>
+    struct _Fetch;
+    template<>
+    struct _Fetch<GpuImage2D>
+    {
+        static std::string glsl(const std::string& sampler)
+        {
+            return "texelFetch(" + sampler + ", p, 0)";
+        }
+    };
+    template<>
+    struct _Fetch<GpuImageRect>
+    {
+        static std::string glsl(const std::string& sampler)
+        {
+            return "texelFetch(" + sampler + ", p)";
+        }
+    };
+    template<>
+    struct _Fetch<GpuBufferImage>
+    {
+        static std::string glsl(const std::string& sampler)
+        {
+            return "texelFetch(" + sampler + ", p.y * uWidth + p.x)";
+        }
+    };
+
+    struct GpuExprContext
+    {
+        std::map<int, std::string> samplers_;   /// declaration and fetch of uIn<N>
+        std::vector<float> consts_;
+    };
+
+    template<typename _E>
+    struct GpuExpr
+    {
+        const _E& self() const
+        {
+            return static_cast<const _E&>(*this);
+        }
+    };
+
+    template<int _N, typename _Img = GpuImage2D>
+    struct Input : public GpuExpr<Input<_N, _Img> >
+    {
+        enum { inputs = _N + 1 };
+        void emit(std::string& code, GpuExprContext& ctx) const
+        {
+            std::string n = std::to_string(_N);
+            ctx.samplers_[_N] = std::string("uniform ") + _Img::glslType() + " uIn" + n + ";\n"
+                "    vec4 t" + n + " = " + _Fetch<_Img>::glsl("uIn" + n) + ";\n";
+            code.append("t").append(n);
+        }
+    };
+
+    struct Const : public GpuExpr<Const>
+    {
+        enum { inputs = 0 };
+        float v_;
+        Const(float v) : v_(v)
+        {
+        }
+        void emit(std::string& code, GpuExprContext& ctx) const
+        {
+            code.append("vec4(uC[").append(std::to_string(ctx.consts_.size())).append("])");
+            ctx.consts_.push_back(v_);
+        }
+    };
+
+    template<typename _Op, typename _A>
+    struct Unary : public GpuExpr<Unary<_Op, _A> >
+    {
+        enum { inputs = _A::inputs };
+        _A a_;
+        Unary(const _A& a) : a_(a)
+        {
+        }
+        void emit(std::string& code, GpuExprContext& ctx) const
+        {
+            code.append(_Op::open());
+            a_.emit(code, ctx);
+            code.append(_Op::close());
+        }
+    };
+
+    template<typename _Op, typename _A, typename _B>
+    struct Binary : public GpuExpr<Binary<_Op, _A, _B> >
+    {
+        enum { inputs = (int)_A::inputs > (int)_B::inputs ? (int)_A::inputs : (int)_B::inputs };
+        _A a_;
+        _B b_;
+        Binary(const _A& a, const _B& b) : a_(a), b_(b)
+        {
+        }
+        void emit(std::string& code, GpuExprContext& ctx) const
+        {
+            code.append(_Op::open());
+            a_.emit(code, ctx);
+            code.append(_Op::sep());
+            b_.emit(code, ctx);
+            code.append(_Op::close());
+        }
+    };
+
+    template<typename _Op, typename _A, typename _B, typename _C>
+    struct Ternary : public GpuExpr<Ternary<_Op, _A, _B, _C> >
+    {
+        enum { inputs_ab = (int)_A::inputs > (int)_B::inputs ? (int)_A::inputs : (int)_B::inputs };
+        enum { inputs = (int)inputs_ab > (int)_C::inputs ? (int)inputs_ab : (int)_C::inputs };
+        _A a_;
+        _B b_;
+        _C c_;
+        Ternary(const _A& a, const _B& b, const _C& c) : a_(a), b_(b), c_(c)
+        {
+        }
+        void emit(std::string& code, GpuExprContext& ctx) const
+        {
+            code.append(_Op::open());
+            a_.emit(code, ctx);
+            code.append(", ");
+            b_.emit(code, ctx);
+            code.append(", ");
+            c_.emit(code, ctx);
+            code.append(")");
+        }
+    };
+
+#define DECLARE_OP(_Name, _Open, _Sep, _Close)   \
+    struct _Name   \
+    {   \
+        static const char* open() { return _Open; }    \
+        static const char* sep() { return _Sep; }  \
+        static const char* close() { return _Close; }  \
+    }
+    DECLARE_OP(_OpAdd, "(", " + ", ")");
+    DECLARE_OP(_OpSub, "(", " - ", ")");
+    DECLARE_OP(_OpMul, "(", " * ", ")");
+    DECLARE_OP(_OpDiv, "(", " / ", ")");
+    DECLARE_OP(_OpMin, "min(", ", ", ")");
+    DECLARE_OP(_OpMax, "max(", ", ", ")");
+    DECLARE_OP(_OpPow, "pow(", ", ", ")");
+    DECLARE_OP(_OpLess, "vec4(lessThan(", ", ", "))");
+    DECLARE_OP(_OpLessEqual, "vec4(lessThanEqual(", ", ", "))");
+    DECLARE_OP(_OpGreater, "vec4(greaterThan(", ", ", "))");
+    DECLARE_OP(_OpGreaterEqual, "vec4(greaterThanEqual(", ", ", "))");
+    DECLARE_OP(_OpNeg, "(-", "", ")");
+    DECLARE_OP(_OpLog, "log(", "", ")");
+    DECLARE_OP(_OpExp, "exp(", "", ")");
+    DECLARE_OP(_OpSqrt, "sqrt(", "", ")");
+    DECLARE_OP(_OpAbs, "abs(", "", ")");
+    DECLARE_OP(_OpClamp, "clamp(", "", ")");
+    DECLARE_OP(_OpMix, "mix(", "", ")");
+    DECLARE_OP(_OpBool, "notEqual(", "", ", vec4(0.0))");
+#undef DECLARE_OP
+
+#define DECLARE_BINARY(_Fn, _Op)    \
+    template<typename _A, typename _B>  \
+    Binary<_Op, _A, _B> _Fn(const GpuExpr<_A>& a, const GpuExpr<_B>& b)    \
+    {   \
+        return Binary<_Op, _A, _B>(a.self(), b.self());    \
+    }   \
+    template<typename _A>   \
+    Binary<_Op, _A, Const> _Fn(const GpuExpr<_A>& a, float b)   \
+    {   \
+        return Binary<_Op, _A, Const>(a.self(), Const(b)); \
+    }   \
+    template<typename _B>   \
+    Binary<_Op, Const, _B> _Fn(float a, const GpuExpr<_B>& b)   \
+    {   \
+        return Binary<_Op, Const, _B>(Const(a), b.self()); \
+    }
+    DECLARE_BINARY(operator+, _OpAdd)
+    DECLARE_BINARY(operator-, _OpSub)
+    DECLARE_BINARY(operator*, _OpMul)
+    DECLARE_BINARY(operator/, _OpDiv)
+    DECLARE_BINARY(operator<, _OpLess)
+    DECLARE_BINARY(operator<=, _OpLessEqual)
+    DECLARE_BINARY(operator>, _OpGreater)
+    DECLARE_BINARY(operator>=, _OpGreaterEqual)
+    DECLARE_BINARY(min, _OpMin)
+    DECLARE_BINARY(max, _OpMax)
+    DECLARE_BINARY(pow, _OpPow)
+#undef DECLARE_BINARY
+
+#define DECLARE_UNARY(_Fn, _Op)    \
+    template<typename _A>   \
+    Unary<_Op, _A> _Fn(const GpuExpr<_A>& a)   \
+    {   \
+        return Unary<_Op, _A>(a.self());   \
+    }
+    DECLARE_UNARY(operator-, _OpNeg)
+    DECLARE_UNARY(log, _OpLog)
+    DECLARE_UNARY(exp, _OpExp)
+    DECLARE_UNARY(sqrt, _OpSqrt)
+    DECLARE_UNARY(abs, _OpAbs)
+#undef DECLARE_UNARY
+
+    template<typename _A>
+    Ternary<_OpClamp, _A, Const, Const> clamp(const GpuExpr<_A>& a, float lo, float hi)
+    {
+        return Ternary<_OpClamp, _A, Const, Const>(a.self(), Const(lo), Const(hi));
+    }
+    /// c is nonzero per channel, a comparison. mix(b, a, bvec4(c))
+    ///  the bvec4 overload picks per channel, inf or nan of the other branch never leaks as 0 * inf.
+    template<typename _C, typename _A, typename _B>
+    Ternary<_OpMix, _B, _A, Unary<_OpBool, _C> > select(const GpuExpr<_C>& c, const GpuExpr<_A>& a, const GpuExpr<_B>& b)
+    {
+        return Ternary<_OpMix, _B, _A, Unary<_OpBool, _C> >(b.self(), a.self(), Unary<_OpBool, _C>(c.self()));
+    }
+    template<typename _C, typename _A>
+    Ternary<_OpMix, Const, _A, Unary<_OpBool, _C> > select(const GpuExpr<_C>& c, const GpuExpr<_A>& a, float b)
+    {
+        return Ternary<_OpMix, Const, _A, Unary<_OpBool, _C> >(Const(b), a.self(), Unary<_OpBool, _C>(c.self()));
+    }
+    template<typename _C, typename _B>
+    Ternary<_OpMix, _B, Const, Unary<_OpBool, _C> > select(const GpuExpr<_C>& c, float a, const GpuExpr<_B>& b)
+    {
+        return Ternary<_OpMix, _B, Const, Unary<_OpBool, _C> >(b.self(), Const(a), Unary<_OpBool, _C>(c.self()));
+    }
+}; // NS expr
+
+    struct GpuExprKernel
+    {
+        std::map<std::string, std::unique_ptr<GpuProgram> > programs_;
+        GpuLauncher launcher_;
+        std::string log_;
+
+        /// the fragment shader of e, and its constants in the order of uC[]
+        template<typename _E>
+        static std::string generate(const expr::GpuExpr<_E>& e, std::vector<float>& consts)
+        {
+            expr::GpuExprContext ctx;
+            std::string body;
+            e.self().emit(body, ctx);
+            std::string fs = "#version 330 core\nuniform int uWidth;\n";
+            if (!ctx.consts_.empty())
+                fs.append("uniform float uC[").append(std::to_string(ctx.consts_.size())).append("];\n");
+            std::string fetch;
+            for (std::map<int, std::string>::iterator it = ctx.samplers_.begin(); it != ctx.samplers_.end(); ++it)
+            {
+                size_t split = it->second.find('\n') + 1;
+                fs.append(it->second, 0, split);
+                fetch.append(it->second, split, std::string::npos);
+            }
+            fs.append("out vec4 fragColor;\nvoid main() {\n    ivec2 p = ivec2(gl_FragCoord.xy);\n");
+            fs.append(fetch);
+            fs.append("    fragColor = ").append(body).append(";\n}\n");
+            consts.swap(ctx.consts_);
+            return fs;
+        }
+        /// input i is bound to the unit i, output is GpuImage2D or GpuImageRect of width x height
+        template<typename _E, typename _Out, typename... _Img>
+        bool run(const expr::GpuExpr<_E>& e, _Out& output, GLsizei width, GLsizei height, _Img&... inputs)
+        {
+            static_assert(sizeof...(_Img) >= (size_t)_E::inputs, "an Input<N> has no image");
+            std::vector<float> consts;
+            GpuProgram* program = build(generate(e, consts));
+            if (!program)
+                return false;
+            program->ensure();
+            if (!consts.empty())
+                glUniform1fv(program->uniform("uC"), (GLsizei)consts.size(), consts.data());
+            program->setUniform1i("uWidth", width);
+            launcher_.launch(*program, output, width, height, inputs...);
+            return true;
+        }
+        size_t programs() const
+        {
+            return programs_.size();
+        }
+    private:
+        GpuProgram* build(const std::string& fs)
+        {
+            std::unique_ptr<GpuProgram>& cached = programs_[fs];
+            if (cached)
+                return cached.get();
+            std::unique_ptr<GpuProgram> program(new GpuProgram);
+            if (!GpuLauncher::build(*program, fs.c_str()))
+            {
+                log_ = program->log_;
+                programs_.erase(fs);
+                return 0;
+            }
+            program->ensure();
+            for (GLint i = 0; i < 16; ++i)
+            {
+                GLint loc = program->uniform(("uIn" + std::to_string(i)).c_str());
+                if (loc >= 0)
+                    glUniform1i(loc, i);
+            }
+            program->leave();
+            cached = std::move(program);
+            return cached.get();
+        }
+    };
+}; // NS GL3
+}; // NS zhelper
+
+#endif // __ZHELPER_EXPR_H_
@@ -0,0 +1,1503 @@
+/**
+MIT License
+
+Copyright (c) 2022-2024 bbqz007 <https://github.com/bbqz007, http://www.cnblogs.com/bbqzsl>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __ZHELPER_FFP_H_
+#define __ZHELPER_FFP_H_
+
+#if !defined(__ZHELPER_GL2_H_) && !defined(__ZHELPER_GLES2_H_)
+#error "include zgl_helper.h or zes_helper.h before zffp_helper.h"
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+/// Z#20261019 Design
+///  GL2::GLFixedPipelineClient, GLCpuClient, Lighting, Light and Material are the fixed pipeline,
+///  glEnableClientState, glLightfv, GL_QUADS, none of them on core profiles or GLES3.
+///  FFP has the classes of the same names and methods, on shaders, VAOs and UBOs.
+///  switch the namespace, `namespace zgl = zhelper::FFP;` for `zhelper::GL2`.
+///
+/// 1. GpuFixedPipeline is the state of the fixed pipeline, one per context.
+/// 1.a makeCurrent() on the thread of the context, the classes use GpuFixedPipeline::current().
+/// 1.b glMatrixMode/glTranslatef/glPushMatrix ... are its methods, matrixMode(), translate(), pushMatrix().
+/// 1.c color4f(), normal3f(), the current color and normal, used when the array is not connected.
+/// 2. uber-shader, one program per variant of the features, compiled on the first draw, cached.
+/// 2.a features, color/normal/texcoord arrays connected, lighting, texture 2D, two side, separate specular, normalize.
+/// 2.b GLSL 330 core, or GLSL 300 es with zes_helper.h.
+/// 3. two uniform blocks, std140, uploaded only when changed.
+/// 3.a ZObject (OBJECT_BINDING), matrices, current color, material. changes per object.
+/// 3.b ZLights (LIGHTS_BINDING), light model, 8 lights in eye space. changes per scene.
+/// 3.c light positions and spot directions are transformed by the modelview when set, as the fixed pipeline.
+/// 4. arrays
+/// 4.a the pointer methods keep the GL_ARRAY_BUFFER bound at the call, as glVertexPointer.
+///     0, a cpu pointer. otherwise an offset in that buffer, no copy at draw.
+/// 4.b the cpu arrays of a draw are written to one streaming buffer (map unsynchronized, orphan on wrap),
+///     only the vertices in the range of the draw, tightly packed.
+/// 4.c GL_QUADS are indexed triangles, GL_QUAD_STRIP is GL_TRIANGLE_STRIP, GL_POLYGON is GL_TRIANGLE_FAN.
+/// 4.d the VAO of the pipeline is bound by ensure(), bind GpuElementArray after it.
+/// 5. saveStates()/saveAttribArrays() push copies of the emulated state, no glPushAttrib.
+///
+/// LIMIT:
+/// 1. texture unit 0 only, GL_MODULATE only. no fog, no alpha test, no clip planes, no color index.
+/// 2. per vertex lighting as the fixed pipeline (Gouraud).
+
+namespace zhelper
+{
+namespace FFP
+{
+    /// the enums of desktop gl, GLES3 has not them
+    enum
+    {
+        QUADS = 0x0007,
+        QUAD_STRIP = 0x0008,
+        POLYGON = 0x0009,
+        MODELVIEW = 0x1700,
+        PROJECTION = 0x1701,
+        LIGHT0 = 0x4000,
+    };
+
+    enum
+    {
+        ATTRIB_VERTEX = 0,
+        ATTRIB_COLOR,
+        ATTRIB_NORMAL,
+        ATTRIB_TEXCOORD,
+        ATTRIB_COUNT,
+
+        OBJECT_BINDING = 22,    /// far from the bindings of GL3::GpuUniformRing users
+        LIGHTS_BINDING = 23,
+        MAX_LIGHTS = 8,
+    };
+
+    /// the variant bits of the uber-shader
+    enum
+    {
+        FEATURE_COLOR_ARRAY = 1 << 0,
+        FEATURE_NORMAL_ARRAY = 1 << 1,
+        FEATURE_TEXCOORD_ARRAY = 1 << 2,
+        FEATURE_LIGHTING = 1 << 3,
+        FEATURE_TEXTURE_2D = 1 << 4,
+        FEATURE_TWO_SIDE = 1 << 5,
+        FEATURE_SEPARATE_SPECULAR = 1 << 6,
+        FEATURE_NORMALIZE = 1 << 7,     /// GL_NORMALIZE, off as the fixed pipeline, normals scaled with the modelview
+    };
+
+    /// column major, as glLoadMatrixf
+    struct Matrix4
+    {
+        GLfloat m_[16];
+
+        static Matrix4 identity()
+        {
+            Matrix4 r;
+            memset(r.m_, 0, sizeof(r.m_));
+            r.m_[0] = r.m_[5] = r.m_[10] = r.m_[15] = 1;
+            return r;
+        }
+        Matrix4 operator*(const Matrix4& b) const
+        {
+            Matrix4 r;
+            for (int c = 0; c < 4; ++c)
+                for (int i = 0; i < 4; ++i)
+                    r.m_[c * 4 + i] = m_[i] * b.m_[c * 4] + m_[4 + i] * b.m_[c * 4 + 1]
+                                    + m_[8 + i] * b.m_[c * 4 + 2] + m_[12 + i] * b.m_[c * 4 + 3];
+            return r;
+        }
+        void transform(const GLfloat* v4f, GLfloat* out) const
+        {
+            for (int i = 0; i < 4; ++i)
+                out[i] = m_[i] * v4f[0] + m_[4 + i] * v4f[1] + m_[8 + i] * v4f[2] + m_[12 + i] * v4f[3];
+        }
+        void transform3(const GLfloat* v3f, GLfloat* out) const
+        {
+            for (int i = 0; i < 3; ++i)
+                out[i] = m_[i] * v3f[0] + m_[4 + i] * v3f[1] + m_[8 + i] * v3f[2];
+        }
+        /// the inverse transpose of the upper 3x3, in a mat4 for std140
+        Matrix4 normalMatrix() const
+        {
+            const GLfloat* a = m_;
+            GLfloat c[9] = {
+                a[5] * a[10] - a[9] * a[6], a[8] * a[6] - a[4] * a[10], a[4] * a[9] - a[8] * a[5],
+                a[9] * a[2] - a[1] * a[10], a[0] * a[10] - a[8] * a[2], a[8] * a[1] - a[0] * a[9],
+                a[1] * a[6] - a[5] * a[2], a[4] * a[2] - a[0] * a[6], a[0] * a[5] - a[4] * a[1],
+            };
+            GLfloat det = a[0] * c[0] + a[4] * c[3] + a[8] * c[6];
+            GLfloat inv = (det != 0) ? 1 / det : 0;
+            /// c[col * 3 + row] is the cofactor of (row, col), the inverse transpose is cofactor / det
+            Matrix4 r = identity();
+            for (int col = 0; col < 3; ++col)
+                for (int row = 0; row < 3; ++row)
+                    r.m_[col * 4 + row] = c[col * 3 + row] * inv;
+            return r;
+        }
+    };
+
+    struct MatrixStack
+    {
+        std::vector<Matrix4> stack_;
+
+        MatrixStack() : stack_(1, Matrix4::identity())
+        {
+        }
+        Matrix4& top()
+        {
+            return stack_.back();
+        }
+        void push()
+        {
+            stack_.push_back(stack_.back());
+        }
+        void pop()
+        {
+            if (stack_.size() > 1)
+                stack_.pop_back();
+        }
+    };
+
+    /// std140, every member a vec4, mat4 or ivec4
+    struct ObjectBlock
+    {
+        GLfloat modelView_[16];
+        GLfloat projection_[16];
+        GLfloat normal_[16];
+        GLfloat color_[4];
+        GLfloat normal3_[4];
+        GLfloat material_[2][4][4];     /// front, back x ambient, diffuse, specular, emission
+        GLfloat shininess_[4];          /// front, back
+        GLint flags_[4];                /// color material mode, color material faces (1 front, 2 back), local viewer
+    };
+
+    struct LightBlock
+    {
+        GLfloat ambient_[4];
+        GLfloat diffuse_[4];
+        GLfloat specular_[4];
+        GLfloat position_[4];           /// eye space
+        GLfloat spot_[4];               /// direction in eye space, cos(cutoff) or -2 for 180
+        GLfloat attenuation_[4];        /// constant, linear, quadratic, spot exponent
+    };
+
+    struct LightsBlock
+    {
+        GLfloat modelAmbient_[4];
+        GLint mask_[4];                 /// enabled lights
+        LightBlock lights_[MAX_LIGHTS];
+    };
+
+    /// glVertexPointer and the friends
+    struct ClientArray
+    {
+        bool enabled_ = false;
+        GLint size_ = 4;
+        GLenum type_ = GL_FLOAT;
+        GLsizei stride_ = 0;
+        const GLvoid* pointer_ = 0;
+        GLuint vbo_ = 0;            /// GL_ARRAY_BUFFER at the pointer call, 0 for cpu memory
+
+        static GLsizei typeSize(GLenum type)
+        {
+            switch (type)
+            {
+            case GL_BYTE:
+            case GL_UNSIGNED_BYTE:
+                return 1;
+            case GL_SHORT:
+            case GL_UNSIGNED_SHORT:
+            case GL_HALF_FLOAT:
+                return 2;
+#ifdef GL_DOUBLE
+            case GL_DOUBLE:
+                return 8;
+#endif
+            default:
+                return 4;
+            }
+        }
+        GLsizei elementSize() const
+        {
+            return size_ * typeSize(type_);
+        }
+        GLsizei effectiveStride() const
+        {
+            return stride_ ? stride_ : elementSize();
+        }
+    };
+
+    /// a buffer written once per draw, never waited
+    struct StreamBuffer
+    {
+        GLenum target_;
+        GLuint vbo_ = 0;
+        GLsizeiptr capacity_ = 0;
+        GLsizeiptr offset_ = 0;
+
+        explicit StreamBuffer(GLenum target) : target_(target)
+        {
+        }
+        ~StreamBuffer()
+        {
+            if (vbo_)
+                glDeleteBuffers(1, &vbo_);
+            vbo_ = 0;
+        }
+        /// the target is bound to the buffer, the space at the returned offset is mapped to vaddr
+        GLintptr map(GLsizeiptr bytes, void*& vaddr)
+        {
+            if (!vbo_)
+                glGenBuffers(1, &vbo_);
+            glBindBuffer(target_, vbo_);
+            if (offset_ + bytes > capacity_)
+            {
+                /// orphan, the draws in flight keep the old storage
+                capacity_ = std::max<GLsizeiptr>(std::max<GLsizeiptr>(capacity_, 1 << 20), bytes);
+                glBufferData(target_, capacity_, 0, GL_STREAM_DRAW);
+                offset_ = 0;
+            }
+            GLintptr at = offset_;
+            vaddr = glMapBufferRange(target_, at, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            offset_ = (at + bytes + 15) & ~(GLsizeiptr)15;
+            return at;
+        }
+        void unmap()
+        {
+            glUnmapBuffer(target_);
+        }
+        GLintptr write(const void* data, GLsizeiptr bytes)
+        {
+            void* vaddr = 0;
+            GLintptr at = map(bytes, vaddr);
+            if (vaddr)
+            {
+                memcpy(vaddr, data, bytes);
+                unmap();
+            }
+            return at;
+        }
+    };
+
+    struct GpuFixedPipeline
+    {
+        /// the emulated state pushed by saveStates()
+        struct States
+        {
+            ObjectBlock object_;
+            LightsBlock lights_;
+            unsigned features_;
+            GLint colorMaterialMode_;
+            bool colorMaterial_;
+            bool depthTest_;
+        };
+
+        MatrixStack modelView_;
+        MatrixStack projection_;
+        GLenum matrixMode_ = MODELVIEW;
+        ObjectBlock object_;
+        LightsBlock lights_;
+        bool objectDirty_ = true;
+        bool lightsDirty_ = true;
+        unsigned features_ = 0;         /// lighting, texture 2D, two side, separate specular
+        GLint colorMaterialMode_ = 3;   /// 1 ambient, 2 diffuse, 3 ambient and diffuse, 4 specular, 5 emission
+        bool colorMaterial_ = false;
+        ClientArray arrays_[ATTRIB_COUNT];
+        std::vector<States> states_;
+        std::vector<std::vector<ClientArray>> arrayStates_;
+        std::map<unsigned, GLuint> programs_;
+        GLuint vao_ = 0;
+        GLuint objectUbo_ = 0;
+        GLuint lightsUbo_ = 0;
+        StreamBuffer vertices_{GL_ARRAY_BUFFER};
+        StreamBuffer indices_{GL_ELEMENT_ARRAY_BUFFER};
+        std::string log_;
+        size_t uploads_ = 0;            /// uniform block uploads, for the stats
+
+        GpuFixedPipeline()
+        {
+            memset(&object_, 0, sizeof(object_));
+            memset(&lights_, 0, sizeof(lights_));
+            Matrix4 id = Matrix4::identity();
+            memcpy(object_.modelView_, id.m_, sizeof(id.m_));
+            memcpy(object_.projection_, id.m_, sizeof(id.m_));
+            memcpy(object_.normal_, id.m_, sizeof(id.m_));
+            setv(object_.color_, 1, 1, 1, 1);
+            setv(object_.normal3_, 0, 0, 1, 0);
+            for (int f = 0; f < 2; ++f)
+            {
+                setv(object_.material_[f][0], 0.2f, 0.2f, 0.2f, 1);
+                setv(object_.material_[f][1], 0.8f, 0.8f, 0.8f, 1);
+                setv(object_.material_[f][2], 0, 0, 0, 1);
+                setv(object_.material_[f][3], 0, 0, 0, 1);
+            }
+            object_.flags_[1] = 3;
+            setv(lights_.modelAmbient_, 0.2f, 0.2f, 0.2f, 1);
+            for (int i = 0; i < MAX_LIGHTS; ++i)
+            {
+                LightBlock& l = lights_.lights_[i];
+                GLfloat on = (i == 0) ? 1.f : 0.f;
+                setv(l.ambient_, 0, 0, 0, 1);
+                setv(l.diffuse_, on, on, on, 1);
+                setv(l.specular_, on, on, on, 1);
+                setv(l.position_, 0, 0, 1, 0);
+                setv(l.spot_, 0, 0, -1, -2);
+                setv(l.attenuation_, 1, 0, 0, 0);
+            }
+            arrays_[ATTRIB_COLOR].size_ = 4;
+            arrays_[ATTRIB_NORMAL].size_ = 3;
+        }
+        ~GpuFixedPipeline()
+        {
+            if (current() == this)
+                current() = 0;
+            for (std::map<unsigned, GLuint>::iterator it = programs_.begin(); it != programs_.end(); ++it)
+                glDeleteProgram(it->second);
+            if (vao_)
+                glDeleteVertexArrays(1, &vao_);
+            if (objectUbo_)
+                glDeleteBuffers(1, &objectUbo_);
+            if (lightsUbo_)
+                glDeleteBuffers(1, &lightsUbo_);
+        }
+        static GpuFixedPipeline*& current()
+        {
+            static thread_local GpuFixedPipeline* pipeline = 0;
+            return pipeline;
+        }
+        void makeCurrent()
+        {
+            current() = this;
+        }
+        /// binds the VAO of the pipeline
+        void ensure()
+        {
+            if (!vao_)
+                glGenVertexArrays(1, &vao_);
+            glBindVertexArray(vao_);
+        }
+
+        /// matrices
+        void matrixMode(GLenum mode)
+        {
+            matrixMode_ = mode;
+        }
+        MatrixStack& matrices()
+        {
+            return (matrixMode_ == PROJECTION) ? projection_ : modelView_;
+        }
+        void loadIdentity()
+        {
+            matrices().top() = Matrix4::identity();
+            objectDirty_ = true;
+        }
+        void loadMatrix(const GLfloat* m16f)
+        {
+            memcpy(matrices().top().m_, m16f, sizeof(GLfloat) * 16);
+            objectDirty_ = true;
+        }
+        void multMatrix(const Matrix4& m)
+        {
+            matrices().top() = matrices().top() * m;
+            objectDirty_ = true;
+        }
+        void translate(GLfloat x, GLfloat y, GLfloat z)
+        {
+            Matrix4 m = Matrix4::identity();
+            m.m_[12] = x;
+            m.m_[13] = y;
+            m.m_[14] = z;
+            multMatrix(m);
+        }
+        void scale(GLfloat x, GLfloat y, GLfloat z)
+        {
+            Matrix4 m = Matrix4::identity();
+            m.m_[0] = x;
+            m.m_[5] = y;
+            m.m_[10] = z;
+            multMatrix(m);
+        }
+        /// degrees, as glRotatef
+        void rotate(GLfloat angle, GLfloat x, GLfloat y, GLfloat z)
+        {
+            GLfloat len = std::sqrt(x * x + y * y + z * z);
+            if (len == 0)
+                return;
+            x /= len;
+            y /= len;
+            z /= len;
+            GLfloat r = angle * 3.14159265358979f / 180, c = std::cos(r), s = std::sin(r), t = 1 - c;
+            Matrix4 m = Matrix4::identity();
+            m.m_[0] = t * x * x + c;     m.m_[4] = t * x * y - s * z; m.m_[8] = t * x * z + s * y;
+            m.m_[1] = t * x * y + s * z; m.m_[5] = t * y * y + c;     m.m_[9] = t * y * z - s * x;
+            m.m_[2] = t * x * z - s * y; m.m_[6] = t * y * z + s * x; m.m_[10] = t * z * z + c;
+            multMatrix(m);
+        }
+        void ortho(GLfloat l, GLfloat r, GLfloat b, GLfloat t, GLfloat n, GLfloat f)
+        {
+            Matrix4 m = Matrix4::identity();
+            m.m_[0] = 2 / (r - l);
+            m.m_[5] = 2 / (t - b);
+            m.m_[10] = -2 / (f - n);
+            m.m_[12] = -(r + l) / (r - l);
+            m.m_[13] = -(t + b) / (t - b);
+            m.m_[14] = -(f + n) / (f - n);
+            multMatrix(m);
+        }
+        void frustum(GLfloat l, GLfloat r, GLfloat b, GLfloat t, GLfloat n, GLfloat f)
+        {
+            Matrix4 m;
+            memset(m.m_, 0, sizeof(m.m_));
+            m.m_[0] = 2 * n / (r - l);
+            m.m_[5] = 2 * n / (t - b);
+            m.m_[8] = (r + l) / (r - l);
+            m.m_[9] = (t + b) / (t - b);
+            m.m_[10] = -(f + n) / (f - n);
+            m.m_[11] = -1;
+            m.m_[14] = -2 * f * n / (f - n);
+            multMatrix(m);
+        }
+        void pushMatrix()
+        {
+            matrices().push();
+        }
+        void popMatrix()
+        {
+            matrices().pop();
+            objectDirty_ = true;
+        }
+
+        /// current attributes
+        void color4f(GLfloat r, GLfloat g, GLfloat b, GLfloat a)
+        {
+            setv(object_.color_, r, g, b, a);
+            objectDirty_ = true;
+        }
+        void normal3f(GLfloat x, GLfloat y, GLfloat z)
+        {
+            setv(object_.normal3_, x, y, z, 0);
+            objectDirty_ = true;
+        }
+
+        /// features
+        void feature(unsigned bit, bool on)
+        {
+            features_ = on ? (features_ | bit) : (features_ & ~bit);
+        }
+        void colorMaterial(bool on)
+        {
+            colorMaterial_ = on;
+            object_.flags_[0] = on ? colorMaterialMode_ : 0;
+            objectDirty_ = true;
+        }
+        /// faces 1 front, 2 back, 3 both
+        void colorMaterialMode(GLint faces, GLint mode)
+        {
+            colorMaterialMode_ = mode;
+            object_.flags_[0] = colorMaterial_ ? mode : 0;
+            object_.flags_[1] = faces;
+            objectDirty_ = true;
+        }
+
+        /// lights, i in [0, MAX_LIGHTS)
+        LightBlock& light(int i)
+        {
+            lightsDirty_ = true;
+            return lights_.lights_[i];
+        }
+        void lightEnable(int i, bool on)
+        {
+            lights_.mask_[0] = on ? (lights_.mask_[0] | (1 << i)) : (lights_.mask_[0] & ~(1 << i));
+            lightsDirty_ = true;
+        }
+        /// by the current modelview
+        void lightPosition(int i, const GLfloat* v4f)
+        {
+            modelView_.top().transform(v4f, light(i).position_);
+        }
+        void lightSpotDirection(int i, const GLfloat* v3f)
+        {
+            modelView_.top().transform3(v3f, light(i).spot_);
+        }
+        void lightSpotCutoff(int i, GLfloat angle)
+        {
+            light(i).spot_[3] = (angle >= 180) ? -2.f : std::cos(angle * 3.14159265358979f / 180);
+        }
+        /// faces 1 front, 2 back, 3 both. k 0 ambient, 1 diffuse, 2 specular, 3 emission
+        void material(GLint faces, int k, const GLfloat* v4f)
+        {
+            for (int f = 0; f < 2; ++f)
+                if (faces & (1 << f))
+                    memcpy(object_.material_[f][k], v4f, sizeof(GLfloat) * 4);
+            objectDirty_ = true;
+        }
+        void shininess(GLint faces, GLfloat exp)
+        {
+            for (int f = 0; f < 2; ++f)
+                if (faces & (1 << f))
+                    object_.shininess_[f] = exp;
+            objectDirty_ = true;
+        }
+
+        void saveStates()
+        {
+            States s;
+            s.object_ = object_;
+            s.lights_ = lights_;
+            s.features_ = features_;
+            s.colorMaterialMode_ = colorMaterialMode_;
+            s.colorMaterial_ = colorMaterial_;
+            s.depthTest_ = glIsEnabled(GL_DEPTH_TEST) == GL_TRUE;
+            states_.push_back(s);
+        }
+        void restoreStates()
+        {
+            if (states_.empty())
+                return;
+            const States& s = states_.back();
+            /// the matrices are not in the attributes of glPushAttrib
+            ObjectBlock object = s.object_;
+            memcpy(object.modelView_, object_.modelView_, sizeof(GLfloat) * 48);
+            object_ = object;
+            lights_ = s.lights_;
+            features_ = s.features_;
+            colorMaterialMode_ = s.colorMaterialMode_;
+            colorMaterial_ = s.colorMaterial_;
+            if (s.depthTest_)
+                glEnable(GL_DEPTH_TEST);
+            else
+                glDisable(GL_DEPTH_TEST);
+            states_.pop_back();
+            objectDirty_ = lightsDirty_ = true;
+        }
+        void saveAttribArrays()
+        {
+            arrayStates_.push_back(std::vector<ClientArray>(arrays_, arrays_ + ATTRIB_COUNT));
+        }
+        void restoreAttribArrays()
+        {
+            if (arrayStates_.empty())
+                return;
+            std::copy(arrayStates_.back().begin(), arrayStates_.back().end(), arrays_);
+            arrayStates_.pop_back();
+        }
+
+        /// glVertexPointer, glColorPointer, glNormalPointer, glTexCoordPointer
+        void pointer(int attrib, GLint size, GLenum type, GLsizei stride, const GLvoid* pointer)
+        {
+            ClientArray& a = arrays_[attrib];
+            a.size_ = size;
+            a.type_ = type;
+            a.stride_ = stride;
+            a.pointer_ = pointer;
+            GLint vbo = 0;
+            glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &vbo);
+            a.vbo_ = (GLuint)vbo;
+        }
+        void connect(int attrib, bool on)
+        {
+            arrays_[attrib].enabled_ = on;
+        }
+
+        void drawArrays(GLenum mode, GLint first, GLsizei count)
+        {
+            if (count <= 0)
+                return;
+            if (mode == QUADS)
+            {
+                std::vector<GLuint> ix;
+                quads(first, count, ix);
+                drawIndexed(GL_TRIANGLES, ix);
+                return;
+            }
+            ensure();
+            bool rebase = !gpuArrays();
+            setupArrays(rebase ? first : 0, first + count, rebase);
+            prepare();
+            glDrawArrays(primitive(mode), rebase ? 0 : first, count);
+        }
+        /// indices, a cpu pointer, or an offset in the GpuElementArray bound after ensure()
+        void drawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid* indices)
+        {
+            if (count <= 0)
+                return;
+            ensure();
+            GLint ebo = 0;
+            glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &ebo);
+            bool ownEbo = (GLuint)ebo == indices_.vbo_;
+            if (mode != QUADS && !cpuArrays() && ebo && !ownEbo)
+            {
+                /// everything is on the gpu, no copy
+                setupArrays(0, 0, false);
+                prepare();
+                glDrawElements(primitive(mode), count, type, indices);
+                return;
+            }
+            std::vector<GLuint> ix((size_t)count);
+            if (ebo && !ownEbo)
+            {
+                GLsizei size = ClientArray::typeSize(type);
+                const void* vaddr = glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, (GLintptr)indices, (GLsizeiptr)count * size, GL_MAP_READ_BIT);
+                if (!vaddr)
+                    return;
+                widen(type, vaddr, count, ix.data());
+                glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+            }
+            else
+                widen(type, indices, count, ix.data());
+            if (mode == QUADS)
+            {
+                std::vector<GLuint> tri;
+                tri.reserve((size_t)count / 4 * 6);
+                for (GLsizei q = 0; q + 3 < count; q += 4)
+                {
+                    GLuint v[6] = {ix[q], ix[q + 1], ix[q + 2], ix[q], ix[q + 2], ix[q + 3]};
+                    tri.insert(tri.end(), v, v + 6);
+                }
+                ix.swap(tri);
+                mode = GL_TRIANGLES;
+            }
+            GLint restore = ownEbo ? 0 : ebo;
+            drawIndexed(primitive(mode), ix);
+            if (restore)
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, restore);
+        }
+
+        /// the program of the current features, compiled on the first use
+        GLuint program()
+        {
+            unsigned variant = features_;
+            if (arrays_[ATTRIB_COLOR].enabled_)
+                variant |= FEATURE_COLOR_ARRAY;
+            if (arrays_[ATTRIB_NORMAL].enabled_)
+                variant |= FEATURE_NORMAL_ARRAY;
+            if (arrays_[ATTRIB_TEXCOORD].enabled_)
+                variant |= FEATURE_TEXCOORD_ARRAY;
+            std::map<unsigned, GLuint>::iterator it = programs_.find(variant);
+            if (it != programs_.end())
+                return it->second;
+            GLuint program = build(variant);
+            programs_[variant] = program;
+            return program;
+        }
+        static std::string header(unsigned variant)
+        {
+#ifdef __ZHELPER_GLES2_H_
+            std::string s("#version 300 es\nprecision highp float;\nprecision highp int;\n");
+#else
+            std::string s("#version 330 core\n");
+#endif
+            static const char* names[] = {
+                "COLOR_ARRAY", "NORMAL_ARRAY", "TEXCOORD_ARRAY", "LIGHTING", "TEXTURE_2D", "TWO_SIDE", "SEPARATE_SPECULAR", "NORMALIZE",
+            };
+            for (int i = 0; i < 8; ++i)
+                if (variant & (1u << i))
+                    s.append("#define ").append(names[i]).append("\n");
+            return s;
+        }
+        static const char* vertexSource()
+        {
+            return
+                "layout(std140) uniform ZObject {\n"
+                "    mat4 uModelView; mat4 uProjection; mat4 uNormalMatrix;\n"
+                "    vec4 uColor; vec4 uNormal;\n"
+                "    vec4 uMaterial[8];\n"
+                "    vec4 uShininess;\n"
+                "    ivec4 uFlags;\n"
+                "};\n"
+                "struct ZLight { vec4 ambient; vec4 diffuse; vec4 specular; vec4 position; vec4 spot; vec4 attenuation; };\n"
+                "layout(std140) uniform ZLights {\n"
+                "    vec4 uModelAmbient; ivec4 uLightMask; ZLight uLights[8];\n"
+                "};\n"
+                "layout(location = 0) in vec4 aVertex;\n"
+                "layout(location = 1) in vec4 aColor;\n"
+                "layout(location = 2) in vec3 aNormal;\n"
+                "layout(location = 3) in vec4 aTexCoord;\n"
+                "out vec4 vColor; out vec4 vSpecular;\n"
+                "#ifdef TWO_SIDE\n"
+                "out vec4 vBackColor; out vec4 vBackSpecular;\n"
+                "#endif\n"
+                "out vec4 vTexCoord;\n"
+                "#ifdef LIGHTING\n"
+                "void shade(int face, vec4 color, vec3 n, vec3 eye, out vec4 primary, out vec4 secondary) {\n"
+                "    vec4 ma = uMaterial[face * 4], md = uMaterial[face * 4 + 1], ms = uMaterial[face * 4 + 2], me = uMaterial[face * 4 + 3];\n"
+                "    float shininess = (face == 0) ? uShininess.x : uShininess.y;\n"
+                "    if ((uFlags.y & (1 << face)) != 0) {\n"
+                "        int mode = uFlags.x;\n"
+                "        if (mode == 1 || mode == 3) ma = color;\n"
+                "        if (mode == 2 || mode == 3) md = color;\n"
+                "        if (mode == 4) ms = color;\n"
+                "        if (mode == 5) me = color;\n"
+                "    }\n"
+                "    vec3 c = me.rgb + uModelAmbient.rgb * ma.rgb;\n"
+                "    vec3 s = vec3(0.0);\n"
+                "    vec3 v = (uFlags.z != 0) ? normalize(-eye) : vec3(0.0, 0.0, 1.0);\n"
+                "    for (int i = 0; i < 8; ++i) {\n"
+                "        if ((uLightMask.x & (1 << i)) == 0) continue;\n"
+                "        vec3 l = uLights[i].position.xyz;\n"
+                "        float att = 1.0;\n"
+                "        if (uLights[i].position.w != 0.0) {\n"
+                "            vec3 d = l - eye; float dist = length(d); l = d / dist;\n"
+                "            vec3 k = uLights[i].attenuation.xyz;\n"
+                "            att = 1.0 / (k.x + k.y * dist + k.z * dist * dist);\n"
+                "        } else l = normalize(l);\n"
+                "        if (uLights[i].spot.w > -1.5) {\n"
+                "            float sd = dot(-l, normalize(uLights[i].spot.xyz));\n"
+                "            att *= (sd < uLights[i].spot.w) ? 0.0 : pow(max(sd, 0.0), uLights[i].attenuation.w);\n"
+                "        }\n"
+                "        float nl = max(dot(n, l), 0.0);\n"
+                "        float nh = max(dot(n, normalize(l + v)), 0.0);\n"
+                "        float sp = (nl > 0.0) ? ((shininess > 0.0) ? pow(nh, shininess) : 1.0) : 0.0;\n"
+                "        c += att * (uLights[i].ambient.rgb * ma.rgb + nl * uLights[i].diffuse.rgb * md.rgb);\n"
+                "        s += att * sp * uLights[i].specular.rgb * ms.rgb;\n"
+                "    }\n"
+                "#ifdef SEPARATE_SPECULAR\n"
+                "    primary = vec4(clamp(c, 0.0, 1.0), md.a); secondary = vec4(clamp(s, 0.0, 1.0), 0.0);\n"
+                "#else\n"
+                "    primary = vec4(clamp(c + s, 0.0, 1.0), md.a); secondary = vec4(0.0);\n"
+                "#endif\n"
+                "}\n"
+                "#endif\n"
+                "void main() {\n"
+                "#ifdef COLOR_ARRAY\n"
+                "    vec4 color = aColor;\n"
+                "#else\n"
+                "    vec4 color = uColor;\n"
+                "#endif\n"
+                "    vec4 eye = uModelView * aVertex;\n"
+                "    gl_Position = uProjection * eye;\n"
+                "#ifdef TEXCOORD_ARRAY\n"
+                "    vTexCoord = aTexCoord;\n"
+                "#else\n"
+                "    vTexCoord = vec4(0.0, 0.0, 0.0, 1.0);\n"
+                "#endif\n"
+                "#ifdef LIGHTING\n"
+                "#ifdef NORMAL_ARRAY\n"
+                "    vec3 n = aNormal;\n"
+                "#else\n"
+                "    vec3 n = uNormal.xyz;\n"
+                "#endif\n"
+                "    n = mat3(uNormalMatrix) * n;\n"
+                "#ifdef NORMALIZE\n"
+                "    n = normalize(n);\n"
+                "#endif\n"
+                "    vec3 e = eye.xyz / eye.w;\n"
+                "    shade(0, color, n, e, vColor, vSpecular);\n"
+                "#ifdef TWO_SIDE\n"
+                "    shade(1, color, -n, e, vBackColor, vBackSpecular);\n"
+                "#endif\n"
+                "#else\n"
+                "    vColor = color; vSpecular = vec4(0.0);\n"
+                "#ifdef TWO_SIDE\n"
+                "    vBackColor = color; vBackSpecular = vec4(0.0);\n"
+                "#endif\n"
+                "#endif\n"
+                "}\n";
+        }
+        static const char* fragmentSource()
+        {
+            return
+                "in vec4 vColor; in vec4 vSpecular;\n"
+                "#ifdef TWO_SIDE\n"
+                "in vec4 vBackColor; in vec4 vBackSpecular;\n"
+                "#endif\n"
+                "in vec4 vTexCoord;\n"
+                "uniform sampler2D uTexture;\n"
+                "out vec4 fragColor;\n"
+                "void main() {\n"
+                "    vec4 c = vColor; vec4 s = vSpecular;\n"
+                "#ifdef TWO_SIDE\n"
+                "    if (!gl_FrontFacing) { c = vBackColor; s = vBackSpecular; }\n"
+                "#endif\n"
+                "#ifdef TEXTURE_2D\n"
+                "    c *= texture(uTexture, vTexCoord.st / vTexCoord.q);\n"
+                "#endif\n"
+                "    fragColor = vec4(c.rgb + s.rgb, c.a);\n"
+                "}\n";
+        }
+    private:
+        static void setv(GLfloat* v, GLfloat a, GLfloat b, GLfloat c, GLfloat d)
+        {
+            v[0] = a;
+            v[1] = b;
+            v[2] = c;
+            v[3] = d;
+        }
+        static GLenum primitive(GLenum mode)
+        {
+            if (mode == QUAD_STRIP)
+                return GL_TRIANGLE_STRIP;
+            if (mode == POLYGON)
+                return GL_TRIANGLE_FAN;
+            return mode;
+        }
+        static void quads(GLint first, GLsizei count, std::vector<GLuint>& ix)
+        {
+            ix.reserve((size_t)count / 4 * 6);
+            for (GLsizei q = 0; q + 3 < count; q += 4)
+            {
+                GLuint v = (GLuint)(first + q);
+                GLuint t[6] = {v, v + 1, v + 2, v, v + 2, v + 3};
+                ix.insert(ix.end(), t, t + 6);
+            }
+        }
+        static void widen(GLenum type, const GLvoid* indices, GLsizei count, GLuint* out)
+        {
+            if (type == GL_UNSIGNED_BYTE)
+                for (GLsizei i = 0; i < count; ++i)
+                    out[i] = ((const GLubyte*)indices)[i];
+            else if (type == GL_UNSIGNED_SHORT)
+                for (GLsizei i = 0; i < count; ++i)
+                    out[i] = ((const GLushort*)indices)[i];
+            else
+                memcpy(out, indices, sizeof(GLuint) * count);
+        }
+        bool gpuArrays() const
+        {
+            for (int i = 0; i < ATTRIB_COUNT; ++i)
+                if (arrays_[i].enabled_ && arrays_[i].vbo_)
+                    return true;
+            return false;
+        }
+        bool cpuArrays() const
+        {
+            for (int i = 0; i < ATTRIB_COUNT; ++i)
+                if (arrays_[i].enabled_ && !arrays_[i].vbo_)
+                    return true;
+            return false;
+        }
+        /// cpu arrays of the vertices [begin, end) to the stream, rebased to 0 if rebase
+        ///  all the cpu arrays are packed into one mapped range, the stream orphans once per draw at most,
+        ///  so no pointer of this draw is left on an orphaned storage.
+        void setupArrays(GLint begin, GLint end, bool rebase)
+        {
+            GLint restore = 0;
+            glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &restore);
+            GLint from = rebase ? begin : 0;
+            GLsizei n = end - from;
+            GLsizeiptr offsets[ATTRIB_COUNT] = {0};
+            GLsizeiptr total = 0;
+            for (int i = 0; i < ATTRIB_COUNT; ++i)
+            {
+                const ClientArray& a = arrays_[i];
+                if (!a.enabled_ || a.vbo_)
+                    continue;
+                offsets[i] = total;
+                total = (total + (GLsizeiptr)n * packedSize(i) + 15) & ~(GLsizeiptr)15;
+            }
+            unsigned char* vaddr = 0;
+            GLintptr at = 0;
+            if (total)
+            {
+                void* mapped = 0;
+                at = vertices_.map(total, mapped);
+                vaddr = (unsigned char*)mapped;
+            }
+            for (int i = 0; i < ATTRIB_COUNT; ++i)
+            {
+                const ClientArray& a = arrays_[i];
+                if (!a.enabled_ || (!a.vbo_ && !vaddr))
+                {
+                    glDisableVertexAttribArray(i);
+                    continue;
+                }
+                bool normalized = (i == ATTRIB_COLOR || i == ATTRIB_NORMAL) && a.type_ != GL_FLOAT
+#ifdef GL_DOUBLE
+                                  && a.type_ != GL_DOUBLE
+#endif
+                                  && a.type_ != GL_HALF_FLOAT;
+                GLint size = (i == ATTRIB_NORMAL) ? 3 : a.size_;
+                if (a.vbo_)
+                {
+                    glBindBuffer(GL_ARRAY_BUFFER, a.vbo_);
+                    glVertexAttribPointer(i, size, a.type_, normalized, a.stride_, a.pointer_);
+                }
+                else
+                {
+                    GLsizei element = packedSize(i);
+                    GLsizei stride = a.stride_ ? a.stride_ : element;
+                    unsigned char* dst = vaddr + offsets[i];
+                    const unsigned char* src = (const unsigned char*)a.pointer_ + (size_t)from * stride;
+                    if (stride == element)
+                        memcpy(dst, src, (size_t)n * element);
+                    else
+                        for (GLsizei k = 0; k < n; ++k)
+                            memcpy(dst + (size_t)k * element, src + (size_t)k * stride, element);
+                    glBindBuffer(GL_ARRAY_BUFFER, vertices_.vbo_);
+                    glVertexAttribPointer(i, size, a.type_, normalized, element, (const GLvoid*)(at + offsets[i]));
+                }
+                glEnableVertexAttribArray(i);
+            }
+            if (vaddr)
+            {
+                glBindBuffer(GL_ARRAY_BUFFER, vertices_.vbo_);
+                vertices_.unmap();
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, restore);
+        }
+        /// bytes of one vertex of the cpu array i in the stream, normals are always 3 components
+        GLsizei packedSize(int i) const
+        {
+            const ClientArray& a = arrays_[i];
+            return (i == ATTRIB_NORMAL) ? 3 * ClientArray::typeSize(a.type_) : a.elementSize();
+        }
+        void drawIndexed(GLenum mode, std::vector<GLuint>& ix)
+        {
+            if (ix.empty())
+                return;
+            ensure();
+            GLuint lo = *std::min_element(ix.begin(), ix.end());
+            GLuint hi = *std::max_element(ix.begin(), ix.end());
+            bool rebase = !gpuArrays();
+            if (rebase && lo)
+                for (size_t i = 0; i < ix.size(); ++i)
+                    ix[i] -= lo;
+            setupArrays(rebase ? (GLint)lo : 0, (GLint)hi + 1, rebase);
+            prepare();
+            GLintptr at = indices_.write(ix.data(), (GLsizeiptr)ix.size() * sizeof(GLuint));
+            glDrawElements(mode, (GLsizei)ix.size(), GL_UNSIGNED_INT, (const GLvoid*)at);
+        }
+        /// the program and the uniform blocks
+        void prepare()
+        {
+            GLuint p = program();
+            glUseProgram(p);
+            if (objectDirty_)
+            {
+                const Matrix4& mv = modelView_.top();
+                memcpy(object_.modelView_, mv.m_, sizeof(mv.m_));
+                memcpy(object_.projection_, projection_.top().m_, sizeof(mv.m_));
+                memcpy(object_.normal_, mv.normalMatrix().m_, sizeof(mv.m_));
+                upload(objectUbo_, &object_, sizeof(object_));
+                objectDirty_ = false;
+            }
+            if (lightsDirty_)
+            {
+                upload(lightsUbo_, &lights_, sizeof(lights_));
+                lightsDirty_ = false;
+            }
+            glBindBufferBase(GL_UNIFORM_BUFFER, OBJECT_BINDING, objectUbo_);
+            glBindBufferBase(GL_UNIFORM_BUFFER, LIGHTS_BINDING, lightsUbo_);
+        }
+        void upload(GLuint& ubo, const void* data, GLsizeiptr bytes)
+        {
+            GLint restore = 0;
+            glGetIntegerv(GL_UNIFORM_BUFFER_BINDING, &restore);
+            if (!ubo)
+            {
+                glGenBuffers(1, &ubo);
+                glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+                glBufferData(GL_UNIFORM_BUFFER, bytes, data, GL_DYNAMIC_DRAW);
+            }
+            else
+            {
+                glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+                glBufferSubData(GL_UNIFORM_BUFFER, 0, bytes, data);
+            }
+            glBindBuffer(GL_UNIFORM_BUFFER, restore);
+            ++uploads_;
+        }
+        GLuint build(unsigned variant)
+        {
+            std::string head = header(variant);
+            GLuint vs = compile(GL_VERTEX_SHADER, head + vertexSource());
+            GLuint fs = compile(GL_FRAGMENT_SHADER, head + fragmentSource());
+            GLuint p = glCreateProgram();
+            glAttachShader(p, vs);
+            glAttachShader(p, fs);
+            glLinkProgram(p);
+            glDeleteShader(vs);
+            glDeleteShader(fs);
+            GLint ok = 0;
+            glGetProgramiv(p, GL_LINK_STATUS, &ok);
+            if (!ok)
+            {
+                char log[4096] = {0};
+                glGetProgramInfoLog(p, sizeof(log), 0, log);
+                log_.append(log);
+            }
+            GLuint object = glGetUniformBlockIndex(p, "ZObject");
+            if (object != GL_INVALID_INDEX)
+                glUniformBlockBinding(p, object, OBJECT_BINDING);
+            GLuint lights = glGetUniformBlockIndex(p, "ZLights");
+            if (lights != GL_INVALID_INDEX)
+                glUniformBlockBinding(p, lights, LIGHTS_BINDING);
+            GLint current = 0;
+            glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+            glUseProgram(p);
+            glUniform1i(glGetUniformLocation(p, "uTexture"), 0);
+            glUseProgram(current);
+            return p;
+        }
+        GLuint compile(GLenum type, const std::string& source)
+        {
+            GLuint s = glCreateShader(type);
+            const char* src = source.c_str();
+            glShaderSource(s, 1, &src, 0);
+            glCompileShader(s);
+            GLint ok = 0;
+            glGetShaderiv(s, GL_COMPILE_STATUS, &ok);
+            if (!ok)
+            {
+                char log[4096] = {0};
+                glGetShaderInfoLog(s, sizeof(log), 0, log);
+                log_.append(log);
+            }
+            return s;
+        }
+    };
+
+    /// the same methods as GL2::GLFixedPipelineClient
+    struct GLFixedPipelineClient
+    {
+        static GpuFixedPipeline& pipeline()
+        {
+            return *GpuFixedPipeline::current();
+        }
+        void ensure()
+        {
+            pipeline().ensure();
+        }
+        GLFixedPipelineClient& connectColor()
+        {
+            pipeline().connect(ATTRIB_COLOR, true); return *this;
+        }
+        GLFixedPipelineClient& connectVertex()
+        {
+            pipeline().connect(ATTRIB_VERTEX, true); return *this;
+        }
+        GLFixedPipelineClient& connectTexCoord()
+        {
+            pipeline().connect(ATTRIB_TEXCOORD, true); return *this;
+        }
+        GLFixedPipelineClient& connectNormal()
+        {
+            pipeline().connect(ATTRIB_NORMAL, true); return *this;
+        }
+        GLFixedPipelineClient& disconnectColor()
+        {
+            pipeline().connect(ATTRIB_COLOR, false); return *this;
+        }
+        GLFixedPipelineClient& disconnectVertex()
+        {
+            pipeline().connect(ATTRIB_VERTEX, false); return *this;
+        }
+        GLFixedPipelineClient& disconnectTexCoord()
+        {
+            pipeline().connect(ATTRIB_TEXCOORD, false); return *this;
+        }
+        GLFixedPipelineClient& disconnectNormal()
+        {
+            pipeline().connect(ATTRIB_NORMAL, false); return *this;
+        }
+
+        void saveAttribArrays()
+        {
+            pipeline().saveAttribArrays();
+        }
+        void restoreAttribArrays()
+        {
+            pipeline().restoreAttribArrays();
+        }
+
+        GLFixedPipelineClient& openTexture2D()
+        {
+            pipeline().feature(FEATURE_TEXTURE_2D, true); return *this;
+        }
+        GLFixedPipelineClient& openLighting()
+        {
+            pipeline().feature(FEATURE_LIGHTING, true); return *this;
+        }
+        GLFixedPipelineClient& openDepthTest()
+        {
+            glEnable(GL_DEPTH_TEST); return *this;
+        }
+        GLFixedPipelineClient& closeTexture2D()
+        {
+            pipeline().feature(FEATURE_TEXTURE_2D, false); return *this;
+        }
+        GLFixedPipelineClient& closeLighting()
+        {
+            pipeline().feature(FEATURE_LIGHTING, false); return *this;
+        }
+        GLFixedPipelineClient& closeDepthTest()
+        {
+            glDisable(GL_DEPTH_TEST); return *this;
+        }
+        /// glEnable(GL_NORMALIZE)
+        GLFixedPipelineClient& openNormalize()
+        {
+            pipeline().feature(FEATURE_NORMALIZE, true); return *this;
+        }
+        GLFixedPipelineClient& closeNormalize()
+        {
+            pipeline().feature(FEATURE_NORMALIZE, false); return *this;
+        }
+
+        void saveStates()
+        {
+            pipeline().saveStates();
+        }
+        void restoreStates()
+        {
+            pipeline().restoreStates();
+        }
+
+        void saveMatrix()
+        {
+            pipeline().pushMatrix();
+        }
+        void restoreMatrix()
+        {
+            pipeline().popMatrix();
+        }
+
+        void clearColor4f(GLclampf r, GLclampf g, GLclampf b, GLclampf a)
+        {
+            glClearColor(r, g, b, a);
+        }
+        void clear(GLbitfield mask)
+        {
+            glClear(mask);
+        }
+        void clearFrontAndBack()
+        {
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+        void clearDepth()
+        {
+            glClear(GL_DEPTH_BUFFER_BIT);
+        }
+        void clearStencil()
+        {
+            glClear(GL_STENCIL_BUFFER_BIT);
+        }
+
+        void drawArrays(GLenum mode, GLint first, GLsizei count)
+        {
+            pipeline().drawArrays(mode, first, count);
+        }
+        void drawElements(GLenum mode, GLsizei count, const GLuint* indices)
+        {
+            pipeline().drawElements(mode, count, GL_UNSIGNED_INT, indices);
+        }
+        void drawElements(GLenum mode, GLsizei count, const GLushort* indices)
+        {
+            pipeline().drawElements(mode, count, GL_UNSIGNED_SHORT, indices);
+        }
+        void drawElements(GLenum mode, GLsizei count, const GLubyte* indices)
+        {
+            pipeline().drawElements(mode, count, GL_UNSIGNED_BYTE, indices);
+        }
+
+        /// GL2::GpuVertexArray::*UseThisGpuBuffer, ensure() the buffer before
+        void vertexUseThisGpuBuffer(GLint size, GLenum type, GLsizei stride, const GLvoid* offset)
+        {
+            pipeline().pointer(ATTRIB_VERTEX, size, type, stride, offset);
+        }
+        void colorUseThisGpuBuffer(GLint size, GLenum type, GLsizei stride, const GLvoid* offset)
+        {
+            pipeline().pointer(ATTRIB_COLOR, size, type, stride, offset);
+        }
+        void normalUseThisGpuBuffer(GLenum type, GLsizei stride, const GLvoid* offset)
+        {
+            pipeline().pointer(ATTRIB_NORMAL, 3, type, stride, offset);
+        }
+        void texCoordUseThisGpuBufferAndCurrentUnit(GLint size, GLenum type, GLsizei stride, const GLvoid* offset)
+        {
+            pipeline().pointer(ATTRIB_TEXCOORD, size, type, stride, offset);
+        }
+    };
+
+    /// the same methods as GL2::GLCpuClient
+    struct GLCpuClient : public GLFixedPipelineClient
+    {
+        void ensure()
+        {
+            GLFixedPipelineClient::ensure();
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        }
+
+        void vertexUseCpuBuffer(GLint size, GLenum type, GLsizei stride, const GLvoid* offset)
+        {
+            pipeline().pointer(ATTRIB_VERTEX, size, type, stride, offset);
+        }
+        void vertexUseCpuBuffer(GLint size, GLenum type, const GLvoid* offset)
+        {
+            pipeline().pointer(ATTRIB_VERTEX, size, type, 0, offset);
+        }
+        void colorUseCpuBuffer(GLint size, GLenum type, GLsizei stride, const GLvoid* offset)
+        {
+            pipeline().pointer(ATTRIB_COLOR, size, type, stride, offset);
+        }
+        void colorUseCpuBuffer(GLint size, GLenum type, const GLvoid* offset)
+        {
+            pipeline().pointer(ATTRIB_COLOR, size, type, 0, offset);
+        }
+        /// unit 0 only
+        void texCoordUseCpuBuffer(GLint unit, GLint size, GLenum type, GLsizei stride, const GLvoid* offset)
+        {
+            if (!unit)
+                pipeline().pointer(ATTRIB_TEXCOORD, size, type, stride, offset);
+        }
+        void texCoordUseCpuBuffer(GLint unit, GLint size, GLenum type, const GLvoid* offset)
+        {
+            if (!unit)
+                pipeline().pointer(ATTRIB_TEXCOORD, size, type, 0, offset);
+        }
+        void texCoordUseCpuBufferAndCurrentUnit(GLint size, GLenum type, GLsizei stride, const GLvoid* offset)
+        {
+            pipeline().pointer(ATTRIB_TEXCOORD, size, type, stride, offset);
+        }
+        void texCoordUseCpuBufferAndCurrentUnit(GLint size, GLenum type, const GLvoid* offset)
+        {
+            pipeline().pointer(ATTRIB_TEXCOORD, size, type, 0, offset);
+        }
+        template<GLsizei _Stride>
+        void colorUseCpuBufferStride(GLint size, GLenum type, const GLvoid* offset)
+        {
+            pipeline().pointer(ATTRIB_COLOR, size, type, _Stride, offset);
+        }
+        void normalUseCpuBuffer(GLenum type, GLsizei stride, const GLvoid* offset)
+        {
+            pipeline().pointer(ATTRIB_NORMAL, 3, type, stride, offset);
+        }
+        void normalUseCpuBuffer(GLenum type, const GLvoid* pointer)
+        {
+            pipeline().pointer(ATTRIB_NORMAL, 3, type, 0, pointer);
+        }
+    };
+
+    /// the same methods as GL2::Lighting
+    struct Lighting
+    {
+        void open()
+        {
+            GpuFixedPipeline::current()->feature(FEATURE_LIGHTING, true);
+        }
+        void close()
+        {
+            GpuFixedPipeline::current()->feature(FEATURE_LIGHTING, false);
+        }
+        void backLightColorGlobal(GLfloat* v4f)
+        {
+            GpuFixedPipeline& p = *GpuFixedPipeline::current();
+            memcpy(p.lights_.modelAmbient_, v4f, sizeof(GLfloat) * 4);
+            p.lightsDirty_ = true;
+        }
+        void highLightAngleOnViewer()
+        {
+            localViewer(1);
+        }
+        void highLightAngleOnTargetObject()
+        {
+            localViewer(0);
+        }
+        void lightBackFaceToo()
+        {
+            GpuFixedPipeline::current()->feature(FEATURE_TWO_SIDE, true);
+        }
+        void lightFrontFaceOnly()
+        {
+            GpuFixedPipeline::current()->feature(FEATURE_TWO_SIDE, false);
+        }
+        void highLightSingleColor()
+        {
+            GpuFixedPipeline::current()->feature(FEATURE_SEPARATE_SPECULAR, false);
+        }
+        void highLightSecondaryColor()
+        {
+            GpuFixedPipeline::current()->feature(FEATURE_SEPARATE_SPECULAR, true);
+        }
+    private:
+        void localViewer(GLint on)
+        {
+            GpuFixedPipeline& p = *GpuFixedPipeline::current();
+            p.object_.flags_[2] = on;
+            p.objectDirty_ = true;
+        }
+    };
+
+    /// the same methods as GL2::Light<GL_LIGHTn>, _N is GL_LIGHTn
+    /// Z#20261019 bug
+    ///  _N was n, Light<GL_LIGHT0> of GL2 code still compiled and wrote lights_[0x4000].
+    template<GLenum _N>
+    struct Light
+    {
+        static_assert(_N >= LIGHT0 && _N < LIGHT0 + MAX_LIGHTS, "_N is GL_LIGHT0 ... GL_LIGHT7");
+        static const int index = _N - LIGHT0;
+        
+        void sunLightColor(GLfloat* v4f)
+        {
+            memcpy(GpuFixedPipeline::current()->light(index).ambient_, v4f, sizeof(GLfloat) * 4);
+        }
+        void backLightColor(GLfloat* v4f)
+        {
+            memcpy(GpuFixedPipeline::current()->light(index).diffuse_, v4f, sizeof(GLfloat) * 4);
+        }
+        void highLightColor(GLfloat* v4f)
+        {
+            memcpy(GpuFixedPipeline::current()->light(index).specular_, v4f, sizeof(GLfloat) * 4);
+        }
+        void sunFrom(GLfloat* _v4f)
+        {
+            GLfloat v4f[4] = {_v4f[0], _v4f[1], _v4f[2], 0};
+            GpuFixedPipeline::current()->lightPosition(index, v4f);
+        }
+        void spotAt(GLfloat* v4f)
+        {
+            GpuFixedPipeline::current()->lightPosition(index, v4f);
+        }
+        void spotDirect(GLfloat* v3f)
+        {
+            GpuFixedPipeline::current()->lightSpotDirection(index, v3f);
+        }
+        void spotOverAll()
+        {
+            GpuFixedPipeline::current()->lightSpotCutoff(index, 180);
+        }
+        void spotAngle(GLint angle)
+        {
+            GpuFixedPipeline::current()->lightSpotCutoff(index, (GLfloat)angle);
+        }
+        void spotFocus(GLint exp)
+        {
+            GpuFixedPipeline::current()->light(index).attenuation_[3] = (GLfloat)exp;
+        }
+        void spotEnergy(GLfloat k, GLfloat linear, GLfloat quadratic)
+        {
+            GLfloat* a = GpuFixedPipeline::current()->light(index).attenuation_;
+            a[0] = k;
+            a[1] = linear;
+            a[2] = quadratic;
+        }
+        void open()
+        {
+            GpuFixedPipeline::current()->lightEnable(index, true);
+        }
+        void close()
+        {
+            GpuFixedPipeline::current()->lightEnable(index, false);
+        }
+    };
+
+#define DECLARE_LIGHT(N)    typedef Light<LIGHT0 + N> Light##N;
+    DECLARE_LIGHT(0);
+    DECLARE_LIGHT(1);
+    DECLARE_LIGHT(2);
+    DECLARE_LIGHT(3);
+    DECLARE_LIGHT(4);
+    DECLARE_LIGHT(5);
+    DECLARE_LIGHT(6);
+    DECLARE_LIGHT(7);
+#undef DECLARE_LIGHT
+
+    /// the same methods as GL2::Material
+    struct Material
+    {
+        void useColorMaterial()
+        {
+            GpuFixedPipeline::current()->colorMaterial(true);
+        }
+        void useMaterial()
+        {
+            GpuFixedPipeline::current()->colorMaterial(false);
+        }
+        template<GLenum _Face>
+        struct Face
+        {
+            enum { FACES = (_Face == GL_FRONT) ? 1 : (_Face == GL_BACK) ? 2 : 3 };
+
+            Face& backLightReflectPct(GLfloat* v4f)
+            {
+                GpuFixedPipeline::current()->material(FACES, 0, v4f); return *this;
+            }
+            Face& sunLightReflectPct(GLfloat* v4f)
+            {
+                GpuFixedPipeline::current()->material(FACES, 1, v4f); return *this;
+            }
+            Face& highLightReflectPct(GLfloat* v4f)
+            {
+                GpuFixedPipeline::current()->material(FACES, 2, v4f); return *this;
+            }
+            Face& highLightExp(GLint exp)
+            {
+                GpuFixedPipeline::current()->shininess(FACES, (GLfloat)exp); return *this;
+            }
+            Face& selfLightColor(GLfloat* v4f)
+            {
+                GpuFixedPipeline::current()->material(FACES, 3, v4f); return *this;
+            }
+            Face& withoutBackLight()
+            {
+                GLfloat no_mat[4] = {0};
+                GpuFixedPipeline::current()->material(FACES, 0, no_mat); return *this;
+            }
+            Face& withoutSunLight()
+            {
+                GLfloat no_mat[4] = {0};
+                GpuFixedPipeline::current()->material(FACES, 1, no_mat); return *this;
+            }
+            Face& withoutHighLight()
+            {
+                GLfloat no_mat[4] = {0};
+                GpuFixedPipeline::current()->material(FACES, 2, no_mat); return *this;
+            }
+            Face& withoutSelfLight()
+            {
+                GLfloat no_mat[4] = {0};
+                GpuFixedPipeline::current()->material(FACES, 3, no_mat); return *this;
+            }
+            /// ColorMaterial, lastest set replace the previous set.
+            Face& applyColorToBackLight()
+            {
+                GpuFixedPipeline::current()->colorMaterialMode(FACES, 1); return *this;
+            }
+            Face& applyColorToSunLight()
+            {
+                GpuFixedPipeline::current()->colorMaterialMode(FACES, 2); return *this;
+            }
+            Face& applyColorToSelfLight()
+            {
+                GpuFixedPipeline::current()->colorMaterialMode(FACES, 5); return *this;
+            }
+            Face& applyColorToHighLight()
+            {
+                GpuFixedPipeline::current()->colorMaterialMode(FACES, 4); return *this;
+            }
+            Face& applyColorToBackAndSunLight()
+            {
+                GpuFixedPipeline::current()->colorMaterialMode(FACES, 3); return *this;
+            }
+        };
+        Face<GL_FRONT> front;
+        Face<GL_BACK> back;
+        Face<GL_FRONT_AND_BACK> both;
+    };
+}; // NS FFP
+}; // NS zhelper
+
+#endif // __ZHELPER_FFP_H_
@@ -40,6 +40,16 @@ SOFTWARE.
 #include <GL/glew.h>
 #endif  // FEATURE_ZHELPER_GL2_USE_SOFTWARE
 
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "zsimd_helper.h"
+
 
 /// Z#20220408 Design
 ///  categories on the docs at 'https://docs.gl'
@@ -313,6 +323,17 @@ namespace GL2
         {
             return glUnmapBuffer(_Ty);
         }
+        /// Z#20261019
+        ///  GL3 at least, map a part only, access GL_MAP_*_BIT
+        void* mmapRange(GLintptr offset, GLsizeiptr size, GLbitfield access)
+        {
+            return glMapBufferRange(_Ty, offset, size, access);
+        }
+        /// with GL_MAP_FLUSH_EXPLICIT_BIT, offset is relative to the mapped range
+        void flushMappedRange(GLintptr offset, GLsizeiptr size)
+        {
+            glFlushMappedBufferRange(_Ty, offset, size);
+        }
         
         GLuint vbo_ = 0;
     };
@@ -827,6 +848,232 @@ namespace GL2
         Face<GL_FRONT_AND_BACK> both;
         
     };
+    
+    /// Z#20261019
+    ///  Light, Lighting and Material call gl at once, the same values again and again every scene.
+    ///  the state records the values, the cache diffs them with the applied ones, only changes go to gl.
+    /// 1. LightingState is plain data, the defaults are the gl defaults, copy it, keep one per object.
+    /// 2. LightingStateCache::apply(state), the light model, the lights and both faces of material.
+    ///    applyMaterial(face, material), the per object switch, no calls if equal.
+    /// 3. GL_POSITION and GL_SPOT_DIRECTION are transformed by the modelview at the call,
+    ///    call viewChanged() after the view of the lights changes, they are applied again.
+    /// 4. the cache starts invalid, the first apply sets all. invalidate() after other gl calls of lighting,
+    ///    glCallList of a LightingDisplayList, glPopAttrib, etc.
+    /// 5. LightingDisplayList compiles a whole state, for static scenes, one glCallList.
+    struct LightState
+    {
+        GLfloat ambient_[4] = {0, 0, 0, 1};
+        GLfloat diffuse_[4] = {0, 0, 0, 1};     /// {1, 1, 1, 1} for GL_LIGHT0
+        GLfloat specular_[4] = {0, 0, 0, 1};    /// {1, 1, 1, 1} for GL_LIGHT0
+        GLfloat position_[4] = {0, 0, 1, 0};
+        GLfloat spotDirection_[3] = {0, 0, -1};
+        GLfloat spotExponent_ = 0;
+        GLfloat spotCutoff_ = 180;
+        GLfloat attenuation_[3] = {1, 0, 0};    /// constant, linear, quadratic
+        bool enabled_ = false;
+    };
+    
+    struct MaterialState
+    {
+        GLfloat ambient_[4] = {0.2f, 0.2f, 0.2f, 1};
+        GLfloat diffuse_[4] = {0.8f, 0.8f, 0.8f, 1};
+        GLfloat specular_[4] = {0, 0, 0, 1};
+        GLfloat emission_[4] = {0, 0, 0, 1};
+        GLfloat shininess_ = 0;
+        
+        bool operator==(const MaterialState& o) const
+        {
+            return !memcmp(this, &o, sizeof(*this));
+        }
+    };
+    
+    struct LightingState
+    {
+        enum { MAX_LIGHTS = 8 };
+        LightState lights_[MAX_LIGHTS];
+        MaterialState front_;
+        MaterialState back_;
+        GLfloat modelAmbient_[4] = {0.2f, 0.2f, 0.2f, 1};
+        GLint localViewer_ = GL_FALSE;
+        GLint twoSide_ = GL_FALSE;
+        GLint colorControl_ = GL_SINGLE_COLOR;
+        bool lighting_ = false;
+        bool colorMaterial_ = false;
+        GLenum colorMaterialFace_ = GL_FRONT_AND_BACK;
+        GLenum colorMaterialMode_ = GL_AMBIENT_AND_DIFFUSE;
+        
+        LightingState()
+        {
+            for (int i = 0; i < 4; ++i)
+                lights_[0].diffuse_[i] = lights_[0].specular_[i] = 1;
+        }
+        LightState& light(int i)
+        {
+            return lights_[i];
+        }
+        /// GL_FRONT or GL_BACK, GL_FRONT_AND_BACK is front_
+        MaterialState& material(GLenum face = GL_FRONT)
+        {
+            return (face == GL_BACK) ? back_ : front_;
+        }
+        /// as Material::Face<GL_FRONT_AND_BACK>
+        void materialBoth(const MaterialState& m)
+        {
+            front_ = back_ = m;
+        }
+    };
+    
+    struct LightingStateCache
+    {
+        LightingState applied_;
+        bool valid_ = false;
+        bool positions_ = false;    /// positions and directions valid under the current view
+        size_t calls_ = 0;          /// gl calls made, for the stats
+        
+        void invalidate()
+        {
+            valid_ = false;
+        }
+        void viewChanged()
+        {
+            positions_ = false;
+        }
+        void apply(const LightingState& s)
+        {
+            bool all = !valid_;
+            LightingState& a = applied_;
+            enable(GL_LIGHTING, s.lighting_, a.lighting_, all);
+            setv(all, a.modelAmbient_, s.modelAmbient_, 4, [&]() { glLightModelfv(GL_LIGHT_MODEL_AMBIENT, s.modelAmbient_); });
+            seti(all, a.localViewer_, s.localViewer_, [&]() { glLightModeli(GL_LIGHT_MODEL_LOCAL_VIEWER, s.localViewer_); });
+            seti(all, a.twoSide_, s.twoSide_, [&]() { glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, s.twoSide_); });
+            seti(all, a.colorControl_, s.colorControl_, [&]() { glLightModeli(GL_LIGHT_MODEL_COLOR_CONTROL, s.colorControl_); });
+            if (all || a.colorMaterialFace_ != s.colorMaterialFace_ || a.colorMaterialMode_ != s.colorMaterialMode_)
+            {
+                glColorMaterial(s.colorMaterialFace_, s.colorMaterialMode_);
+                a.colorMaterialFace_ = s.colorMaterialFace_;
+                a.colorMaterialMode_ = s.colorMaterialMode_;
+                ++calls_;
+            }
+            enable(GL_COLOR_MATERIAL, s.colorMaterial_, a.colorMaterial_, all);
+            for (int i = 0; i < LightingState::MAX_LIGHTS; ++i)
+                applyLight(i, s.lights_[i], all);
+            positions_ = true;
+            /// while invalid, the materials are sent whole too
+            applyMaterial(GL_FRONT, s.front_);
+            applyMaterial(GL_BACK, s.back_);
+            valid_ = true;
+        }
+        /// GL_FRONT, GL_BACK or GL_FRONT_AND_BACK. apply() once before, the cache is valid.
+        void applyMaterial(GLenum face, const MaterialState& m)
+        {
+            if (face == GL_FRONT_AND_BACK && valid_ && applied_.front_ == m && applied_.back_ == m)
+                return;
+            if (face == GL_FRONT_AND_BACK && (!valid_ || applied_.front_ == applied_.back_))
+            {
+                /// both faces in one call each
+                applyFace(GL_FRONT_AND_BACK, applied_.front_, m, !valid_);
+                applied_.back_ = applied_.front_;
+                return;
+            }
+            if (face != GL_BACK)
+                applyFace(GL_FRONT, applied_.front_, m, !valid_);
+            if (face != GL_FRONT)
+                applyFace(GL_BACK, applied_.back_, m, !valid_);
+        }
+    private:
+        void applyLight(int i, const LightState& s, bool all)
+        {
+            GLenum n = GL_LIGHT0 + i;
+            LightState& a = applied_.lights_[i];
+            bool was = a.enabled_;
+            enable(n, s.enabled_, a.enabled_, all);
+            /// a disabled light is not compared, its values go to gl when it is enabled
+            if (!s.enabled_ && !all)
+                return;
+            bool reset = all || !was;
+            setv(reset, a.ambient_, s.ambient_, 4, [&]() { glLightfv(n, GL_AMBIENT, s.ambient_); });
+            setv(reset, a.diffuse_, s.diffuse_, 4, [&]() { glLightfv(n, GL_DIFFUSE, s.diffuse_); });
+            setv(reset, a.specular_, s.specular_, 4, [&]() { glLightfv(n, GL_SPECULAR, s.specular_); });
+            bool view = reset || !positions_;
+            setv(view, a.position_, s.position_, 4, [&]() { glLightfv(n, GL_POSITION, s.position_); });
+            setv(view, a.spotDirection_, s.spotDirection_, 3, [&]() { glLightfv(n, GL_SPOT_DIRECTION, s.spotDirection_); });
+            setf(reset, a.spotExponent_, s.spotExponent_, [&]() { glLightf(n, GL_SPOT_EXPONENT, s.spotExponent_); });
+            setf(reset, a.spotCutoff_, s.spotCutoff_, [&]() { glLightf(n, GL_SPOT_CUTOFF, s.spotCutoff_); });
+            setf(reset, a.attenuation_[0], s.attenuation_[0], [&]() { glLightf(n, GL_CONSTANT_ATTENUATION, s.attenuation_[0]); });
+            setf(reset, a.attenuation_[1], s.attenuation_[1], [&]() { glLightf(n, GL_LINEAR_ATTENUATION, s.attenuation_[1]); });
+            setf(reset, a.attenuation_[2], s.attenuation_[2], [&]() { glLightf(n, GL_QUADRATIC_ATTENUATION, s.attenuation_[2]); });
+        }
+        void applyFace(GLenum face, MaterialState& a, const MaterialState& s, bool all)
+        {
+            setv(all, a.ambient_, s.ambient_, 4, [&]() { glMaterialfv(face, GL_AMBIENT, s.ambient_); });
+            setv(all, a.diffuse_, s.diffuse_, 4, [&]() { glMaterialfv(face, GL_DIFFUSE, s.diffuse_); });
+            setv(all, a.specular_, s.specular_, 4, [&]() { glMaterialfv(face, GL_SPECULAR, s.specular_); });
+            setv(all, a.emission_, s.emission_, 4, [&]() { glMaterialfv(face, GL_EMISSION, s.emission_); });
+            setf(all, a.shininess_, s.shininess_, [&]() { glMaterialf(face, GL_SHININESS, s.shininess_); });
+        }
+        void enable(GLenum cap, bool want, bool& applied, bool all)
+        {
+            if (!all && want == applied)
+                return;
+            if (want)
+                glEnable(cap);
+            else
+                glDisable(cap);
+            applied = want;
+            ++calls_;
+        }
+        template<typename _Fn>
+        void setv(bool all, GLfloat* applied, const GLfloat* want, int n, _Fn call)
+        {
+            if (!all && !memcmp(applied, want, n * sizeof(GLfloat)))
+                return;
+            call();
+            memcpy(applied, want, n * sizeof(GLfloat));
+            ++calls_;
+        }
+        template<typename _Fn>
+        void setf(bool all, GLfloat& applied, GLfloat want, _Fn call)
+        {
+            setv(all, &applied, &want, 1, call);
+        }
+        template<typename _Fn>
+        void seti(bool all, GLint& applied, GLint want, _Fn call)
+        {
+            if (!all && applied == want)
+                return;
+            call();
+            applied = want;
+            ++calls_;
+        }
+    };
+    
+    /// a whole LightingState in one display list, compatibility contexts only.
+    ///  the positions are transformed by the modelview at glCallList, not at compile.
+    struct LightingDisplayList
+    {
+        GLuint list_ = 0;
+        
+        ~LightingDisplayList()
+        {
+            if (list_)
+                glDeleteLists(list_, 1);
+            list_ = 0;
+        }
+        void compile(const LightingState& s)
+        {
+            if (!list_)
+                list_ = glGenLists(1);
+            LightingStateCache all;
+            glNewList(list_, GL_COMPILE);
+            all.apply(s);
+            glEndList();
+        }
+        /// the cache of the context is stale after it, see LightingStateCache::invalidate()
+        void call()
+        {
+            glCallList(list_);
+        }
+    };
 }; // NS GL2
 }; // NS zhelper
 
@@ -939,6 +1186,38 @@ namespace GL2
             return mmapWriteOnly();
         }
     };
+    struct GpuPixelBufferDrawableSaver
+    {
+        GLint handle;
+        ~GpuPixelBufferDrawableSaver()
+        {
+            if (handle)
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, handle);
+        }
+        GpuPixelBufferDrawableSaver() 
+        {
+            handle = GpuPixelBufferDrawable::queryCurrentBinding();
+            if (handle)
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+    };
+    /// Z#20261019
+    ///  GL_UNPACK_ALIGNMENT and GL_PACK_ALIGNMENT are 4 by default,
+    ///  rows of 1 or 2 bytes texels (R8, R16F, ...) are not 4 bytes aligned when the width is odd.
+    template<GLenum _Pname>
+    struct GpuPixelStoreSaver
+    {
+        GLint value;
+        ~GpuPixelStoreSaver()
+        {
+            glPixelStorei(_Pname, value);
+        }
+        GpuPixelStoreSaver(GLint v)
+        {
+            glGetIntegerv(_Pname, &value);
+            glPixelStorei(_Pname, v);
+        }
+    };
     
     // Z#20240116
     /// GpuPixelBuffer is a failure wrapper, 
@@ -1154,6 +1433,116 @@ namespace GL3
     
     typedef GL2::GpuElementArray GpuElementArray;
     
+    /// Z#20261019
+    /// typed texel formats, each one picks the matching (internalFormat, format, type) triple.
+    /// host_type is the scalar of one channel in gpu memory layout.
+    /// fromFloat and toFloat convert n scalars between float [] and host_type [], see zsimd_helper.h.
+    /// 1. 16F, half of the GL_FLOAT transfer bytes, F16C.
+    /// 2. 8, 16 (unorm), 1/4 and 1/2 of the GL_FLOAT transfer bytes, AVX2. values are clamped to [0, 1].
+    /// 3. 8I, 16UI, 32I, ... integer, values are casted, GLSL should use isampler or usampler.
+    template<typename _HostTy>
+    struct _GpuFormatCast
+    {
+        typedef _HostTy host_type;
+        static void fromFloat(const float* src, host_type* dst, size_t n)
+        {
+            simd::castCopy(src, dst, n);
+        }
+        static void toFloat(const host_type* src, float* dst, size_t n)
+        {
+            simd::castCopy(src, dst, n);
+        }
+    };
+    struct _GpuFormatHalf
+    {
+        typedef GLhalf host_type;
+        static void fromFloat(const float* src, host_type* dst, size_t n)
+        {
+            simd::floatToHalf(src, dst, n);
+        }
+        static void toFloat(const host_type* src, float* dst, size_t n)
+        {
+            simd::halfToFloat(src, dst, n);
+        }
+    };
+    struct _GpuFormatUnorm8
+    {
+        typedef GLubyte host_type;
+        static void fromFloat(const float* src, host_type* dst, size_t n)
+        {
+            simd::floatToUnorm8(src, dst, n);
+        }
+        static void toFloat(const host_type* src, float* dst, size_t n)
+        {
+            simd::unorm8ToFloat(src, dst, n);
+        }
+    };
+    struct _GpuFormatUnorm16
+    {
+        typedef GLushort host_type;
+        static void fromFloat(const float* src, host_type* dst, size_t n)
+        {
+            simd::floatToUnorm16(src, dst, n);
+        }
+        static void toFloat(const host_type* src, float* dst, size_t n)
+        {
+            simd::unorm16ToFloat(src, dst, n);
+        }
+    };
+    
+    template<GLint _InternalFormat, GLenum _Format, GLenum _Type, GLint _Channels, typename _Cvt>
+    struct GpuFormat : public _Cvt
+    {
+        typedef typename _Cvt::host_type host_type;
+        static const GLint internalFormat = _InternalFormat;
+        static const GLenum format = _Format;
+        static const GLenum type = _Type;
+        static const GLint channels = _Channels;
+        static const GLsizei texelBytes = _Channels * sizeof(host_type);
+    };
+    
+#define DECLARE_FORMAT(_IF_, _F_, _T_, _C_, _CVT_)  typedef GpuFormat<GL_##_IF_, _F_, _T_, _C_, _CVT_> GpuFormat##_IF_;
+    DECLARE_FORMAT(R32F, GL_RED, GL_FLOAT, 1, _GpuFormatCast<GLfloat>);
+    DECLARE_FORMAT(RG32F, GL_RG, GL_FLOAT, 2, _GpuFormatCast<GLfloat>);
+    DECLARE_FORMAT(RGBA32F, GL_RGBA, GL_FLOAT, 4, _GpuFormatCast<GLfloat>);
+    DECLARE_FORMAT(R16F, GL_RED, GL_HALF_FLOAT, 1, _GpuFormatHalf);
+    DECLARE_FORMAT(RG16F, GL_RG, GL_HALF_FLOAT, 2, _GpuFormatHalf);
+    DECLARE_FORMAT(RGBA16F, GL_RGBA, GL_HALF_FLOAT, 4, _GpuFormatHalf);
+    DECLARE_FORMAT(R8, GL_RED, GL_UNSIGNED_BYTE, 1, _GpuFormatUnorm8);
+    DECLARE_FORMAT(RG8, GL_RG, GL_UNSIGNED_BYTE, 2, _GpuFormatUnorm8);
+    DECLARE_FORMAT(RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 4, _GpuFormatUnorm8);
+    DECLARE_FORMAT(R16, GL_RED, GL_UNSIGNED_SHORT, 1, _GpuFormatUnorm16);
+    DECLARE_FORMAT(RG16, GL_RG, GL_UNSIGNED_SHORT, 2, _GpuFormatUnorm16);
+    DECLARE_FORMAT(RGBA16, GL_RGBA, GL_UNSIGNED_SHORT, 4, _GpuFormatUnorm16);
+    DECLARE_FORMAT(R8I, GL_RED_INTEGER, GL_BYTE, 1, _GpuFormatCast<GLbyte>);
+    DECLARE_FORMAT(R8UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, 1, _GpuFormatCast<GLubyte>);
+    DECLARE_FORMAT(RGBA8UI, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, 4, _GpuFormatCast<GLubyte>);
+    DECLARE_FORMAT(R16I, GL_RED_INTEGER, GL_SHORT, 1, _GpuFormatCast<GLshort>);
+    DECLARE_FORMAT(R16UI, GL_RED_INTEGER, GL_UNSIGNED_SHORT, 1, _GpuFormatCast<GLushort>);
+    DECLARE_FORMAT(R32I, GL_RED_INTEGER, GL_INT, 1, _GpuFormatCast<GLint>);
+    DECLARE_FORMAT(R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, 1, _GpuFormatCast<GLuint>);
+    DECLARE_FORMAT(RGBA32I, GL_RGBA_INTEGER, GL_INT, 4, _GpuFormatCast<GLint>);
+    DECLARE_FORMAT(RGBA32UI, GL_RGBA_INTEGER, GL_UNSIGNED_INT, 4, _GpuFormatCast<GLuint>);
+#undef DECLARE_FORMAT
+    
+    /// Z#20261019
+    ///  GL3 at least, extensions are listed one by one by glGetStringi.
+    struct GpuExtensions
+    {
+        static bool has(const char* name)
+        {
+            GLint n = 0;
+            glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+            for (GLint i = 0; i < n; ++i)
+            {
+                const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+                if (ext && 0 == strcmp(ext, name))
+                    return true;
+            }
+            return false;
+        }
+    };
+    
     template<GLenum _Ty>
     struct GpuImage
     {
@@ -1207,6 +1596,33 @@ namespace GL3
             if (GL2::GpuPixelBufferReadable::queryCurrentBinding())
                 glReadPixels(x, y, width, height, format, type, offset);
         }
+        /// Z#20261019
+        ///  download as _Fmt texels, and convert to float [] on cpu host side.
+        template<typename _Fmt, GLint _Lv = 0>
+        void copyToFloatMemory(float* cpumem)
+        {
+            GLint width = 0, height = 0;
+            glGetTexLevelParameteriv(_Ty, _Lv, GL_TEXTURE_WIDTH, &width);
+            glGetTexLevelParameteriv(_Ty, _Lv, GL_TEXTURE_HEIGHT, &height);
+            size_t n = (size_t)width * height * _Fmt::channels;
+            std::vector<typename _Fmt::host_type> texels(n);
+            GL2::GpuPixelBufferReadableSaver pbo;
+            GL2::GpuPixelStoreSaver<GL_PACK_ALIGNMENT> align(1);
+            glGetTexImage(_Ty, _Lv, _Fmt::format, _Fmt::type, texels.data());
+            _Fmt::toFloat(texels.data(), cpumem, n);
+        }
+        template<typename _Fmt>
+        void copyToFloatMemory(GLint x, GLint y, GLsizei width, GLsizei height, float* cpumem)
+        {
+            /// depend to FBO
+            /// you should GpuFBODevice::openReadCurrentFBO() first
+            size_t n = (size_t)width * height * _Fmt::channels;
+            std::vector<typename _Fmt::host_type> texels(n);
+            GL2::GpuPixelBufferReadableSaver pbo;
+            GL2::GpuPixelStoreSaver<GL_PACK_ALIGNMENT> align(1);
+            glReadPixels(x, y, width, height, _Fmt::format, _Fmt::type, texels.data());
+            _Fmt::toFloat(texels.data(), cpumem, n);
+        }
         template<GLint _Lv = 0>
         void alloc(GLint internalFormat, GLsizei width, GLsizei height, GLint border,
                    GLenum format, GLenum type, const GLvoid* data = 0);
@@ -1277,10 +1693,12 @@ namespace GL3
         
         void setGP()
         {
+            /// Z#20261019 bug
+            ///  GL_CLAMP has gone since 3.1 core, GL_INVALID_ENUM.
             setMinFilterToNearest();
             setMagFilterToNearest();
-            setWrapS(GL_CLAMP);
-            setWrapT(GL_CLAMP);
+            setWrapS(GL_CLAMP_TO_EDGE);
+            setWrapT(GL_CLAMP_TO_EDGE);
         }
     };
     
@@ -1323,174 +1741,1259 @@ namespace GL3
             if (GL2::GpuPixelBufferDrawable::queryCurrentBinding())
                 glTexSubImage2D(GL_TEXTURE_2D, _Lv, xoffset, yoffset, width, height, format, type, data);
         }
-    };
-    
-    struct GpuImageRect : public GpuImage123D<GL_TEXTURE_RECTANGLE>
-    {
-        template<GLint _Lv = 0>
-        void alloc(GLint internalFormat, GLsizei width, GLsizei height, GLint border,
-                   GLenum format, GLenum type, const GLvoid* data = 0)
-        {
-            (GL_TEXTURE_RECTANGLE, _Lv, internalFormat, width, height, border, format, type, data);
-        }
-        template<GLint _Lv = 0>
-        void copyFromCpuMemory(GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, 
-                   GLenum format, GLenum type, const GLvoid* data = 0)
+        /// Z#20261019
+        ///  typed formats, see GpuFormat.
+        template<typename _Fmt, GLint _Lv = 0>
+        void allocFormat(GLsizei width, GLsizei height, const GLvoid* data = 0)
         {
-            glTexSubImage2D(GL_TEXTURE_RECTANGLE, _Lv, xoffset, yoffset, width, height, format, type, data);
+            glTexImage2D(GL_TEXTURE_2D, _Lv, _Fmt::internalFormat, width, height, 0, _Fmt::format, _Fmt::type, data);
         }
-        template<GLenum _Target = GL_TEXTURE_2D, GLint _Lv = 0>
-        void copyFromCurrentFBO(GLint xoffset, GLint yoffset, GLint x, GLint y, GLsizei width, GLsizei height)
+        template<typename _Fmt, GLint _Lv = 0>
+        void copyFromFloatMemory(GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, const float* data)
         {
-            glCopyTexSubImage2D(_Target, _Lv, xoffset, yoffset, x, y, width, height);
+            /// convert on cpu host side, then upload the narrow texels.
+            size_t n = (size_t)width * height * _Fmt::channels;
+            std::vector<typename _Fmt::host_type> texels(n);
+            _Fmt::fromFloat(data, texels.data(), n);
+            GL2::GpuPixelBufferDrawableSaver pbo;
+            GL2::GpuPixelStoreSaver<GL_UNPACK_ALIGNMENT> align(1);
+            glTexSubImage2D(GL_TEXTURE_2D, _Lv, xoffset, yoffset, width, height, _Fmt::format, _Fmt::type, texels.data());
         }
-        
         static const char* glslType()
         {
-            return "sampler2DRect";
+            return "sampler2D";
         }
     };
     
-    struct _Traits_GpuTexBuffer
+    /// Z#20261019
+    ///  merged dirty byte intervals [begin, end), sorted.
+    ///  begin and end are rounded to granularity_ (1 byte, or 4096 for pages).
+    ///  intervals closer than mergeGap_ are merged too, fewer calls for a few more bytes.
+    struct GpuDirtyRanges
     {
-        static int queryCurrentBinding()
+        struct Range
         {
-            GLint vbo = 0;
-            glGetIntegerv(GL_TEXTURE_BUFFER_BINDING, &vbo);
-            return vbo;
+            size_t begin_;
+            size_t end_;
+        };
+        std::vector<Range> ranges_;
+        size_t granularity_ = 1;
+        size_t mergeGap_ = 0;
+        
+        /// ranges beyond limit are clamped, or dropped when they start at or after it
+        void mark(size_t offset, size_t size, size_t limit)
+        {
+            if (!size || offset >= limit)
+                return;
+            size = std::min(size, limit - offset);
+            size_t g = granularity_ ? granularity_ : 1;
+            Range r = {offset / g * g, std::min(limit, (offset + size + g - 1) / g * g)};
+            /// the first range whose end reaches r.begin_ - gap
+            size_t i = 0;
+            while (i < ranges_.size() && ranges_[i].end_ + mergeGap_ < r.begin_)
+                ++i;
+            size_t j = i;
+            while (j < ranges_.size() && ranges_[j].begin_ <= r.end_ + mergeGap_)
+            {
+                r.begin_ = std::min(r.begin_, ranges_[j].begin_);
+                r.end_ = std::max(r.end_, ranges_[j].end_);
+                ++j;
+            }
+            ranges_.erase(ranges_.begin() + i, ranges_.begin() + j);
+            ranges_.insert(ranges_.begin() + i, r);
+        }
+        size_t bytes() const
+        {
+            size_t n = 0;
+            for (size_t i = 0; i < ranges_.size(); ++i)
+                n += ranges_[i].end_ - ranges_[i].begin_;
+            return n;
+        }
+        bool empty() const
+        {
+            return ranges_.empty();
+        }
+        void clear()
+        {
+            ranges_.clear();
         }
     };
     
-    struct GpuTexBuffer : public GL2::GpuBuffer<GL_TEXTURE_BUFFER, true, _Traits_GpuTexBuffer>
+    struct GpuFlushStats
     {
+        size_t ranges_ = 0;         /// glBufferSubData or glFlushMappedBufferRange calls
+        size_t bytesFlushed_ = 0;
+        size_t bytesSaved_ = 0;     /// against copy(0, size, data)
         
+        GpuFlushStats& operator+=(const GpuFlushStats& o)
+        {
+            ranges_ += o.ranges_;
+            bytesFlushed_ += o.bytesFlushed_;
+            bytesSaved_ += o.bytesSaved_;
+            return *this;
+        }
     };
     
-    struct GpuTexBufferHandle : public GL2::GpuBuffer<GL_TEXTURE_BUFFER, false, _Traits_GpuTexBuffer>
+    /// Z#20261019
+    ///  a cpu mirror of a GpuBuffer, only the dirty ranges go to the gpu memory.
+    ///  _Buffer is GpuVertexArray, GpuTexBuffer (attach to GpuBufferImage by alloc(internalFormat, vbo_)), ...
+    /// 1. write() copies to the mirror and marks, or change data() yourself then markDirty().
+    /// 2. flush(), the buffer should be ensured.
+    /// 2.a glBufferSubData for every range, by default.
+    /// 2.b useMapFlush_, map the span of the ranges with GL_MAP_FLUSH_EXPLICIT_BIT,
+    ///      then glFlushMappedBufferRange for every range, one map for many ranges.
+    /// 3. flush() returns the stats of this flush, total_ sums all flushes.
+    /// 3.a when the map or the unmap fails, the ranges are kept dirty, the stats are zero.
+    template<typename _Buffer>
+    struct GpuMirroredBuffer : public _Buffer
     {
+        std::vector<unsigned char> mirror_;
+        GpuDirtyRanges dirty_;
+        GpuFlushStats total_;
+        bool useMapFlush_ = false;
         
-    };
-    
-    /// buffer texture can not attach to FBO
-    /// buffer texture is 1D array.
-    /// Z#20240118 doc
-    ///  PBO and GL_TEXTURE_BUFFER are buffers can bind to a sort of TEXURE with the same name GL_TEXTURE_BUFFER
-    /// carefully
-    ///  buffer of GL_TEXTURE_BUFFER
-    ///  texture of GL_TEXTURE_BUFFER
-    struct GpuBufferImage : public GpuImage<GL_TEXTURE_BUFFER>
-    {
-        GpuTexBuffer self_buf_;
-        void ensure(GLuint n = 0)
-        {
-            if (self_buf_.vbo_)
-                self_buf_.ensure();
-            GpuImage::ensure(n);
-        }
-        /// Z#20240118 add pbo
-        void attach(GLint internalFormat, GL2::GpuPixelBufferReadable& pbo)
+        /// the buffer should be ensured, the mirror is zero filled and all dirty.
+        void alloc(GLsizeiptr size, GLenum usage)
         {
-            alloc(internalFormat, pbo.vbo_);
+            _Buffer::alloc(size, usage);
+            mirror_.assign(size, 0);
+            dirty_.clear();
+            dirty_.mark(0, size, size);
         }
-        void attach(GLint internalFormat, GL2::GpuPixelBufferDrawable& pbo)
+        void alloc(GLsizeiptr size, const GLvoid* data, GLenum usage)
         {
-            alloc(internalFormat, pbo.vbo_);
+            _Buffer::alloc(size, data, usage);
+            mirror_.assign((const unsigned char*)data, (const unsigned char*)data + size);
+            dirty_.clear();
         }
-        void alloc(GLint internalFormat, GLuint buffer)
+        void setGranularity(size_t bytes, size_t mergeGap = 0)
         {
-            /// the buffer is ensured by user
-            /// Z#20240118
-            ///  attenuation!!!
-            ///  the buffer can be GL_TEXTRUE_BUFFER or PBO
-            glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, buffer);
+            dirty_.granularity_ = bytes;
+            dirty_.mergeGap_ = mergeGap;
         }
-        void alloc(GLint internalFormat, GLsizeiptr bytes, GLenum usage = GL_STATIC_READ)
+        void write(GLintptr offset, GLsizeiptr size, const GLvoid* data)
         {
-            self_buf_.ensure();
-            self_buf_.alloc(bytes, usage);
-            alloc(internalFormat, self_buf_.vbo_); 
-            // self_buf_.leave();
+            memcpy(&mirror_[offset], data, size);
+            markDirty(offset, size);
         }
-        void alloc(GLint internalFormat, GLsizeiptr bytes, const GLvoid* data, GLenum usage = GL_STATIC_READ)
+        void markDirty(GLintptr offset, GLsizeiptr size)
         {
-            self_buf_.ensure();
-            self_buf_.alloc(bytes, data, usage);
-            alloc(internalFormat, self_buf_.vbo_);
-            // self_buf_.leave();
+            dirty_.mark(offset, size, mirror_.size());
         }
-        void copyFromCpuMemory(GLintptr offset, GLsizeiptr bytes, const GLvoid* data)
+        template<typename _Ty = unsigned char>
+        _Ty* data()
         {
-            GpuTexBufferHandle handle;
-            handle.vbo_ = bufferId();
-            handle.copy(offset, bytes, data);
+            return (_Ty*)mirror_.data();
         }
-        void copyFromCpuMemory(GLsizeiptr bytes, const GLvoid* data)
+        size_t size() const
         {
-            GpuTexBufferHandle handle;
-            handle.vbo_ = bufferId();
-            handle.copy(0, bytes, data);
+            return mirror_.size();
         }
-        void copyToCpuMemory(GLintptr offset, GLsizeiptr bytes, GLvoid* data)
+        GpuFlushStats flush()
         {
-            GpuTexBufferHandle handle;
-            handle.vbo_ = bufferId();
-            handle.copyTo(offset, bytes, data);
+            GpuFlushStats stats;
+            if (dirty_.empty())
+            {
+                stats.bytesSaved_ = mirror_.size();
+                total_ += stats;
+                return stats;
+            }
+            const std::vector<GpuDirtyRanges::Range>& ranges = dirty_.ranges_;
+            if (useMapFlush_)
+            {
+                size_t begin = ranges.front().begin_, end = ranges.back().end_;
+                unsigned char* vaddr = (unsigned char*)this->mmapRange(begin, end - begin, GL_MAP_WRITE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+                if (!vaddr)
+                    return stats;
+                for (size_t i = 0; i < ranges.size(); ++i)
+                {
+                    size_t len = ranges[i].end_ - ranges[i].begin_;
+                    memcpy(vaddr + ranges[i].begin_ - begin, &mirror_[ranges[i].begin_], len);
+                    this->flushMappedRange(ranges[i].begin_ - begin, len);
+                }
+                /// GL_FALSE, the whole data store is undefined, not only the range mapped.
+                ///  all of the mirror is sent again next time.
+                if (!this->unmap())
+                {
+                    dirty_.mark(0, mirror_.size(), mirror_.size());
+                    return stats;
+                }
+            }
+            else
+            {
+                for (size_t i = 0; i < ranges.size(); ++i)
+                    this->copy(ranges[i].begin_, ranges[i].end_ - ranges[i].begin_, &mirror_[ranges[i].begin_]);
+            }
+            stats.ranges_ = ranges.size();
+            stats.bytesFlushed_ = dirty_.bytes();
+            stats.bytesSaved_ = mirror_.size() - stats.bytesFlushed_;
+            total_ += stats;
+            dirty_.clear();
+            return stats;
         }
-        void copyToCpuMemory(GLsizeiptr bytes, GLvoid* data)
+    };
+    
+    /// Z#20261019
+    ///  hundreds of small copyFromCpuMemory() for dirty rects, hundreds of driver transfers.
+    ///  the uploader packs all the rects into one GpuPixelBufferDrawable mapping,
+    ///  then issues the glTexSubImage2D calls from the buffer offsets in one burst.
+    /// 1. add() a rect, data is its first texel, rowLength (texels) is the row pitch of the cpu memory.
+    /// 1.a addFromImage() for a rect inside a cpu mirror of the whole image.
+    /// 2. flush() coalesces rects which are adjacent both in the image and in the cpu memory,
+    ///     so the merged rect is a valid rect of the cpu memory.
+    /// 3. when all rects come from one mirror and cover >= denseRatio_ of their bounding box,
+    ///     the bounding rows are copied as one block, each rect is issued with
+    ///     GL_UNPACK_ROW_LENGTH, GL_UNPACK_SKIP_PIXELS and GL_UNPACK_SKIP_ROWS into it.
+    /// 3.a otherwise every rect is packed tightly.
+    /// 4. the pixel store states of the caller are saved and restored.
+    /// 5. the image should be ensured, flush() returns the count of glTexSubImage2D.
+    ///    -1 when the map or unmap of the PBO failed, nothing is uploaded, the rects are kept for the next flush().
+    struct GpuRegionUploader
+    {
+        struct Region
+        {
+            GLint x_;
+            GLint y_;
+            GLsizei width_;
+            GLsizei height_;
+            const unsigned char* data_;
+            GLint rowLength_;
+            GLintptr offset_;
+        };
+        std::vector<Region> regions_;
+        GL2::GpuPixelBufferDrawable pbo_;
+        GLenum format_;
+        GLenum type_;
+        GLsizei texelBytes_;
+        const unsigned char* image_ = 0;    /// the mirror, 0 when rects come from anywhere
+        GLint imageRowLength_ = 0;
+        bool mixed_ = false;
+        float denseRatio_ = 0.5f;
+        
+        GpuRegionUploader(GLenum format, GLenum type, GLsizei texelBytes)
+            : format_(format), type_(type), texelBytes_(texelBytes)
         {
-            GpuTexBufferHandle handle;
-            handle.vbo_ = bufferId();
-            handle.copyTo(0, bytes, data);
         }
-        void copyToCpuMemory(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid* cpumem)
+        template<typename _Fmt>
+        static GpuRegionUploader of()
         {
-            /// oveloaded the base class method
-            /// buffer texture can not attach to FBO
-            
+            return GpuRegionUploader(_Fmt::format, _Fmt::type, _Fmt::texelBytes);
         }
-        GLint maxSize()
+        void add(GLint x, GLint y, GLsizei width, GLsizei height, const GLvoid* data, GLint rowLength = 0)
         {
-            GLint size;
-            glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &size);
-            return size;
+            if (width <= 0 || height <= 0)
+                return;
+            Region r = {x, y, width, height, (const unsigned char*)data, rowLength ? rowLength : width, 0};
+            regions_.push_back(r);
+            mixed_ = true;
         }
-        GLint bufferId()
+        void addFromImage(const GLvoid* image, GLint imageRowLength, GLint x, GLint y, GLsizei width, GLsizei height)
         {
-            /// Z#20220413 bug GL_TEXTURE_BINDING_BUFFER
-            ///   GL_TEXTURE_BINDING_BUFFER get the texid or bufid ?
-            /// 1. get the current texid which glBindTexture to GL_TEXTURE_BUFFER 
-            /// 2. get the current bufid which glBindBuffer to GL_TEXTURE_BUFFER
-            GLint bufid;
-            glGetIntegerv(GL_TEXTURE_BINDING_BUFFER, &bufid);
-            return bufid;
+            if (width <= 0 || height <= 0)
+                return;
+            const unsigned char* base = (const unsigned char*)image;
+            if (regions_.empty())
+                mixed_ = false;
+            else if (base != image_ || imageRowLength != imageRowLength_)
+                mixed_ = true;
+            image_ = base;
+            imageRowLength_ = imageRowLength;
+            Region r = {x, y, width, height, base + ((size_t)y * imageRowLength + x) * texelBytes_, imageRowLength, 0};
+            regions_.push_back(r);
         }
-        
-        void setGP()
+        size_t pending() const
         {
-            /// do nothing
+            return regions_.size();
         }
-        
-        static const char* glslType()
+        void clear()
         {
-            return "samplerBuffer";
+            regions_.clear();
+            image_ = 0;
+            mixed_ = false;
         }
-    };
-    
-    /// this is the general default framebuffer which is called window-system-provided framebuffer.
-    /// http://www.songho.ca/opengl/gl_fbo.html#:~:text=By%20default%2C%20OpenGL%20uses%20the,window%2Dsystem%2Dprovided%20framebuffer.
-    /// https://www.khronos.org/opengl/wiki/Framebuffer
-    struct GpuRenderDevice
-    {
-        void ensure()
+        void coalesce()
         {
-            /// Z#20220421 bug
-            ///  0 is not the default framebuffer, it just unbind anything.
-            ///  1 would be the default framebuffer. 
-            ///  but i have no idea about NV or ATI drivers.
-            /// thanks to https://stackoverflow.com/questions/11617013/why-would-glbindframebuffergl-framebuffer-0-result-in-blank-screen-in-cocos2d
-            glBindFramebuffer(GL_FRAMEBUFFER, 1);
+            bool merged = true;
+            while (merged && regions_.size() > 1)
+            {
+                merged = mergeRows() | mergeColumns();
+            }
         }
-        static void openReadOnFront()
+        template<GLenum _Target = GL_TEXTURE_2D, GLint _Lv = 0>
+        GLsizei flush()
+        {
+            if (regions_.empty())
+                return 0;
+            coalesce();
+            GL2::GpuPixelStoreSaver<GL_UNPACK_ALIGNMENT> align(1);
+            GL2::GpuPixelStoreSaver<GL_UNPACK_ROW_LENGTH> rowLength(0);
+            GL2::GpuPixelStoreSaver<GL_UNPACK_SKIP_PIXELS> skipPixels(0);
+            GL2::GpuPixelStoreSaver<GL_UNPACK_SKIP_ROWS> skipRows(0);
+            pbo_.ensure();
+            
+            GLint x0 = regions_[0].x_, y0 = regions_[0].y_, x1 = x0, y1 = y0;
+            size_t texels = 0;
+            for (size_t i = 0; i < regions_.size(); ++i)
+            {
+                const Region& r = regions_[i];
+                x0 = std::min(x0, r.x_);
+                y0 = std::min(y0, r.y_);
+                x1 = std::max(x1, r.x_ + r.width_);
+                y1 = std::max(y1, r.y_ + r.height_);
+                texels += (size_t)r.width_ * r.height_;
+            }
+            size_t boxTexels = (size_t)(x1 - x0) * (y1 - y0);
+            bool uploaded = false;
+            if (!mixed_ && image_ && texels >= denseRatio_ * boxTexels)
+            {
+                /// one block of the bounding rows
+                GLsizeiptr rowBytes = (GLsizeiptr)(x1 - x0) * texelBytes_;
+                pbo_.allocDynamic(rowBytes * (y1 - y0));
+                unsigned char* vaddr = (unsigned char*)pbo_.mmapRange(0, rowBytes * (y1 - y0), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+                if (vaddr)
+                {
+                    const unsigned char* src = image_ + ((size_t)y0 * imageRowLength_ + x0) * texelBytes_;
+                    for (GLint y = y0; y < y1; ++y, vaddr += rowBytes, src += (size_t)imageRowLength_ * texelBytes_)
+                        memcpy(vaddr, src, rowBytes);
+                    uploaded = pbo_.unmap();
+                }
+                if (uploaded)
+                {
+                    glPixelStorei(GL_UNPACK_ROW_LENGTH, x1 - x0);
+                    for (size_t i = 0; i < regions_.size(); ++i)
+                    {
+                        const Region& r = regions_[i];
+                        glPixelStorei(GL_UNPACK_SKIP_PIXELS, r.x_ - x0);
+                        glPixelStorei(GL_UNPACK_SKIP_ROWS, r.y_ - y0);
+                        glTexSubImage2D(_Target, _Lv, r.x_, r.y_, r.width_, r.height_, format_, type_, 0);
+                    }
+                }
+            }
+            else
+            {
+                GLsizeiptr bytes = 0;
+                for (size_t i = 0; i < regions_.size(); ++i)
+                {
+                    regions_[i].offset_ = bytes;
+                    bytes += (GLsizeiptr)regions_[i].width_ * regions_[i].height_ * texelBytes_;
+                }
+                pbo_.allocDynamic(bytes);
+                unsigned char* vaddr = (unsigned char*)pbo_.mmapRange(0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+                if (vaddr)
+                {
+                    for (size_t i = 0; i < regions_.size(); ++i)
+                    {
+                        const Region& r = regions_[i];
+                        size_t rowBytes = (size_t)r.width_ * texelBytes_;
+                        unsigned char* dst = vaddr + r.offset_;
+                        const unsigned char* src = r.data_;
+                        for (GLsizei y = 0; y < r.height_; ++y, dst += rowBytes, src += (size_t)r.rowLength_ * texelBytes_)
+                            memcpy(dst, src, rowBytes);
+                    }
+                    uploaded = pbo_.unmap();
+                }
+                if (uploaded)
+                {
+                    for (size_t i = 0; i < regions_.size(); ++i)
+                    {
+                        const Region& r = regions_[i];
+                        glTexSubImage2D(_Target, _Lv, r.x_, r.y_, r.width_, r.height_, format_, type_, (const GLvoid*)r.offset_);
+                    }
+                }
+            }
+            pbo_.leave();
+            /// Z#20261019 bug
+            ///  a failed map or unmap issued nothing, the rects were cleared and lost.
+            if (!uploaded)
+                return -1;
+            GLsizei calls = (GLsizei)regions_.size();
+            clear();
+            return calls;
+        }
+    private:
+        bool mergeRows()
+        {
+            /// A | B, the same rows, B follows A in the cpu memory too
+            std::sort(regions_.begin(), regions_.end(), [](const Region& a, const Region& b) {
+                return a.y_ != b.y_ ? a.y_ < b.y_ : (a.height_ != b.height_ ? a.height_ < b.height_ : a.x_ < b.x_);
+            });
+            return merge([this](const Region& a, const Region& b) {
+                return a.y_ == b.y_ && a.height_ == b.height_ && a.rowLength_ == b.rowLength_
+                    && b.x_ == a.x_ + a.width_ && b.data_ == a.data_ + (size_t)a.width_ * texelBytes_;
+            }, true);
+        }
+        bool mergeColumns()
+        {
+            /// A over B, the same columns, B follows A rows in the cpu memory too
+            std::sort(regions_.begin(), regions_.end(), [](const Region& a, const Region& b) {
+                return a.x_ != b.x_ ? a.x_ < b.x_ : (a.width_ != b.width_ ? a.width_ < b.width_ : a.y_ < b.y_);
+            });
+            return merge([this](const Region& a, const Region& b) {
+                return a.x_ == b.x_ && a.width_ == b.width_ && a.rowLength_ == b.rowLength_
+                    && b.y_ == a.y_ + a.height_ && b.data_ == a.data_ + (size_t)a.height_ * a.rowLength_ * texelBytes_;
+            }, false);
+        }
+        template<typename _Pred>
+        bool merge(_Pred adjacent, bool rows)
+        {
+            bool merged = false;
+            size_t w = 0;
+            for (size_t i = 1; i < regions_.size(); ++i)
+            {
+                if (adjacent(regions_[w], regions_[i]))
+                {
+                    if (rows)
+                        regions_[w].width_ += regions_[i].width_;
+                    else
+                        regions_[w].height_ += regions_[i].height_;
+                    merged = true;
+                }
+                else
+                    regions_[++w] = regions_[i];
+            }
+            regions_.resize(w + 1);
+            return merged;
+        }
+    };
+    
+    /// Z#20261019
+    ///  texel addressed, texelFetch(uIn, ivec2(gl_FragCoord.xy)) or texture(uIn, gl_FragCoord.xy),
+    ///  no normalization by the size in the kernel.
+    /// 1. only level 0, no mipmaps, _Lv must be 0 for GL_TEXTURE_RECTANGLE.
+    /// 2. no GL_REPEAT, setGP() of GpuImage123D clamps to edge.
+    /// 3. pin it to FBO by color0PinGpuImageRect(image), or color0PinGpuImage(image).
+    struct GpuImageRect : public GpuImage123D<GL_TEXTURE_RECTANGLE>
+    {
+        /// immutable storage, GL4.2 at least
+        void alloc(GLint internalFormat, GLsizei width, GLsizei height)
+        {
+            glTexStorage2D(GL_TEXTURE_RECTANGLE, 1, internalFormat, width, height);
+        }
+        template<GLint _Lv = 0>
+        void alloc(GLint internalFormat, GLsizei width, GLsizei height, GLint border,
+                   GLenum format, GLenum type, const GLvoid* data = 0)
+        {
+            /// Z#20261019 bug
+            ///  glTexImage2D was missing, the expression did nothing.
+            static_assert(_Lv == 0, "GL_TEXTURE_RECTANGLE has level 0 only");
+            glTexImage2D(GL_TEXTURE_RECTANGLE, _Lv, internalFormat, width, height, border, format, type, data);
+        }
+        template<GLint _Lv = 0>
+        void copyFromCpuMemory(GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, 
+                   GLenum format, GLenum type, const GLvoid* data = 0)
+        {
+            static_assert(_Lv == 0, "GL_TEXTURE_RECTANGLE has level 0 only");
+            glTexSubImage2D(GL_TEXTURE_RECTANGLE, _Lv, xoffset, yoffset, width, height, format, type, data);
+        }
+        /// Z#20261019 bug
+        ///  _Target was GL_TEXTURE_2D, GL_INVALID_ENUM for the bound rectangle texture.
+        template<GLenum _Target = GL_TEXTURE_RECTANGLE, GLint _Lv = 0>
+        void copyFromCurrentFBO(GLint xoffset, GLint yoffset, GLint x, GLint y, GLsizei width, GLsizei height)
+        {
+            glCopyTexSubImage2D(_Target, _Lv, xoffset, yoffset, x, y, width, height);
+        }
+        template<GLint _Lv = 0>
+        void copyFromGpuPixelBufferDrawable(GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+                   GLenum format, GLenum type, const GLvoid* data = 0)
+        {
+            static_assert(_Lv == 0, "GL_TEXTURE_RECTANGLE has level 0 only");
+            if (GL2::GpuPixelBufferDrawable::queryCurrentBinding())
+                glTexSubImage2D(GL_TEXTURE_RECTANGLE, _Lv, xoffset, yoffset, width, height, format, type, data);
+        }
+        template<typename _Fmt>
+        void allocFormat(GLsizei width, GLsizei height, const GLvoid* data = 0)
+        {
+            glTexImage2D(GL_TEXTURE_RECTANGLE, 0, _Fmt::internalFormat, width, height, 0, _Fmt::format, _Fmt::type, data);
+        }
+        template<typename _Fmt>
+        void copyFromFloatMemory(GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, const float* data)
+        {
+            size_t n = (size_t)width * height * _Fmt::channels;
+            std::vector<typename _Fmt::host_type> texels(n);
+            _Fmt::fromFloat(data, texels.data(), n);
+            GL2::GpuPixelBufferDrawableSaver pbo;
+            GL2::GpuPixelStoreSaver<GL_UNPACK_ALIGNMENT> align(1);
+            glTexSubImage2D(GL_TEXTURE_RECTANGLE, 0, xoffset, yoffset, width, height, _Fmt::format, _Fmt::type, texels.data());
+        }
+        
+        static const char* glslType()
+        {
+            return "sampler2DRect";
+        }
+    };
+    
+    /// Z#20261019
+    ///  many slices of the same size, one texture, one FBO, one draw.
+    ///  GL_TEXTURE_2D_ARRAY, slices are layers. GL_TEXTURE_3D, slices are depths.
+    /// 1. alloc<_Lv>(internalFormat, width, height, layers), immutable storage, GL4.2 at least.
+    /// 2. pin one slice to FBO by color0PinGpuImageLayer(image, layer),
+    ///    or all slices by color0PinGpuImage(image), the layered attachment.
+    /// 3. layered attachment, the vertex/geometry shader selects the slice by gl_Layer, see GpuLayeredPass.
+    template<GLenum _Ty>
+    struct _GpuImageLayered : public GpuImage123D<_Ty>
+    {
+        template<GLint _Lv = 1>
+        void alloc(GLint internalFormat, GLsizei width, GLsizei height, GLsizei layers)
+        {
+            glTexStorage3D(_Ty, _Lv, internalFormat, width, height, layers);
+        }
+        template<GLint _Lv = 0>
+        void alloc(GLint internalFormat, GLsizei width, GLsizei height, GLsizei layers, GLint border,
+                   GLenum format, GLenum type, const GLvoid* data = 0)
+        {
+            glTexImage3D(_Ty, _Lv, internalFormat, width, height, layers, border, format, type, data);
+        }
+        template<typename _Fmt, GLint _Lv = 0>
+        void allocFormat(GLsizei width, GLsizei height, GLsizei layers, const GLvoid* data = 0)
+        {
+            glTexImage3D(_Ty, _Lv, _Fmt::internalFormat, width, height, layers, 0, _Fmt::format, _Fmt::type, data);
+        }
+        template<GLint _Lv = 0>
+        void copyFromCpuMemory(GLint xoffset, GLint yoffset, GLint layer, GLsizei width, GLsizei height, GLsizei layers,
+                   GLenum format, GLenum type, const GLvoid* data = 0)
+        {
+            glTexSubImage3D(_Ty, _Lv, xoffset, yoffset, layer, width, height, layers, format, type, data);
+        }
+        template<typename _Fmt, GLint _Lv = 0>
+        void copyFromFloatMemory(GLint xoffset, GLint yoffset, GLint layer, GLsizei width, GLsizei height, GLsizei layers, const float* data)
+        {
+            size_t n = (size_t)width * height * layers * _Fmt::channels;
+            std::vector<typename _Fmt::host_type> texels(n);
+            _Fmt::fromFloat(data, texels.data(), n);
+            GL2::GpuPixelBufferDrawableSaver pbo;
+            GL2::GpuPixelStoreSaver<GL_UNPACK_ALIGNMENT> align(1);
+            glTexSubImage3D(_Ty, _Lv, xoffset, yoffset, layer, width, height, layers, _Fmt::format, _Fmt::type, texels.data());
+        }
+        template<GLint _Lv = 0>
+        void copyFromGpuPixelBufferDrawable(GLint xoffset, GLint yoffset, GLint layer, GLsizei width, GLsizei height, GLsizei layers,
+                   GLenum format, GLenum type, const GLvoid* data = 0)
+        {
+            if (GL2::GpuPixelBufferDrawable::queryCurrentBinding())
+                glTexSubImage3D(_Ty, _Lv, xoffset, yoffset, layer, width, height, layers, format, type, data);
+        }
+        /// all slices, slice after slice
+        template<typename _Fmt, GLint _Lv = 0>
+        void copyToFloatMemory(float* cpumem)
+        {
+            GLint width = 0, height = 0, layers = 0;
+            glGetTexLevelParameteriv(_Ty, _Lv, GL_TEXTURE_WIDTH, &width);
+            glGetTexLevelParameteriv(_Ty, _Lv, GL_TEXTURE_HEIGHT, &height);
+            glGetTexLevelParameteriv(_Ty, _Lv, GL_TEXTURE_DEPTH, &layers);
+            size_t n = (size_t)width * height * layers * _Fmt::channels;
+            std::vector<typename _Fmt::host_type> texels(n);
+            GL2::GpuPixelBufferReadableSaver pbo;
+            GL2::GpuPixelStoreSaver<GL_PACK_ALIGNMENT> align(1);
+            glGetTexImage(_Ty, _Lv, _Fmt::format, _Fmt::type, texels.data());
+            _Fmt::toFloat(texels.data(), cpumem, n);
+        }
+        void setGP()
+        {
+            GpuImage123D<_Ty>::setGP();
+            this->setWrapR(GL_CLAMP_TO_EDGE);
+        }
+    };
+    
+    struct GpuImage2DArray : public _GpuImageLayered<GL_TEXTURE_2D_ARRAY>
+    {
+        static const char* glslType()
+        {
+            return "sampler2DArray";
+        }
+    };
+    
+    struct GpuImage3D : public _GpuImageLayered<GL_TEXTURE_3D>
+    {
+        static const char* glslType()
+        {
+            return "sampler3D";
+        }
+    };
+    
+    struct _Traits_GpuTexBuffer
+    {
+        static int queryCurrentBinding()
+        {
+            GLint vbo = 0;
+            glGetIntegerv(GL_TEXTURE_BUFFER_BINDING, &vbo);
+            return vbo;
+        }
+    };
+    
+    struct GpuTexBuffer : public GL2::GpuBuffer<GL_TEXTURE_BUFFER, true, _Traits_GpuTexBuffer>
+    {
+        
+    };
+    
+    struct GpuTexBufferHandle : public GL2::GpuBuffer<GL_TEXTURE_BUFFER, false, _Traits_GpuTexBuffer>
+    {
+        
+    };
+    
+    /// Z#20261019
+    ///  parameters of kernels, one buffer rather than dozens of glUniform* per dispatch.
+    ///  GL_UNIFORM_BUFFER GL3.1, GL_SHADER_STORAGE_BUFFER GL4.3.
+    struct _Traits_GpuUniformBuffer
+    {
+        static int queryCurrentBinding()
+        {
+            GLint vbo = 0;
+            glGetIntegerv(GL_UNIFORM_BUFFER_BINDING, &vbo);
+            return vbo;
+        }
+        static GLenum target()
+        {
+            return GL_UNIFORM_BUFFER;
+        }
+        static GLint offsetAlignment()
+        {
+            GLint align = 256;
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+            return align;
+        }
+    };
+    
+    struct _Traits_GpuShaderStorageBuffer
+    {
+        static int queryCurrentBinding()
+        {
+            GLint vbo = 0;
+            glGetIntegerv(GL_SHADER_STORAGE_BUFFER_BINDING, &vbo);
+            return vbo;
+        }
+        static GLenum target()
+        {
+            return GL_SHADER_STORAGE_BUFFER;
+        }
+        static GLint offsetAlignment()
+        {
+            GLint align = 256;
+            glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &align);
+            return align;
+        }
+    };
+    
+    template<GLenum _Ty, typename _Traits>
+    struct _GpuIndexedBuffer : public GL2::GpuBuffer<_Ty, true, _Traits>
+    {
+        typedef _Traits traits_type;
+        /// the binding point `index` of the blocks, layout(binding = index) or GpuProgram::bindUniformBlock
+        void bindBase(GLuint index)
+        {
+            glBindBufferBase(_Ty, index, this->vbo_);
+        }
+        /// offset is a multiple of _Traits::offsetAlignment()
+        void bindRange(GLuint index, GLintptr offset, GLsizeiptr size)
+        {
+            glBindBufferRange(_Ty, index, this->vbo_, offset, size);
+        }
+    };
+    
+    struct GpuUniformBuffer : public _GpuIndexedBuffer<GL_UNIFORM_BUFFER, _Traits_GpuUniformBuffer>
+    {
+        
+    };
+    
+    struct GpuShaderStorageBuffer : public _GpuIndexedBuffer<GL_SHADER_STORAGE_BUFFER, _Traits_GpuShaderStorageBuffer>
+    {
+        
+    };
+    
+    /// Z#20261019
+    ///  C++ types with the base alignments of std140, a struct of them has the offsets of the GLSL block.
+    ///  the same for std430, except arrays, where a plain C array of scalars or vec2 is std430.
+    /// 1. no vec3, the 16 bytes C++ vec3 would push the next float to +16, GLSL puts it at +12.
+    /// 2. the elements of std140::array are padded to 16 bytes.
+    /// 3. check a block by GpuStd140Block<T>, and the offsets by ZHELPER_STD140_OFFSET.
+    namespace std140
+    {
+        struct alignas(8) vec2 { GLfloat x, y; };
+        struct alignas(16) vec4 { GLfloat x, y, z, w; };
+        struct alignas(8) ivec2 { GLint x, y; };
+        struct alignas(16) ivec4 { GLint x, y, z, w; };
+        struct alignas(16) uvec4 { GLuint x, y, z, w; };
+        struct alignas(16) mat4 { vec4 col[4]; };
+        template<typename _Ty, int _N>
+        struct alignas(16) array
+        {
+            struct alignas(16) element { _Ty v; };
+            element a_[_N];
+            _Ty& operator[](int i) { return a_[i].v; }
+            const _Ty& operator[](int i) const { return a_[i].v; }
+        };
+    }; // NS std140
+    
+    template<typename _Ty>
+    struct GpuStd140Block
+    {
+        static_assert(std::is_standard_layout<_Ty>::value, "std140 block must be standard layout");
+        static_assert(std::is_trivially_copyable<_Ty>::value, "std140 block is copied by memcpy");
+        static_assert(sizeof(_Ty) % 16 == 0, "std140 block size is a multiple of 16, pad it with a vec4 or floats");
+        static_assert(alignof(_Ty) <= 16, "std140 base alignment is 16 at most");
+        enum { value = 1 };
+    };
+#define ZHELPER_STD140_OFFSET(_Block, _Member, _Offset) \
+    static_assert(offsetof(_Block, _Member) == (_Offset), #_Block "::" #_Member " is not at " #_Offset " in std140")
+    
+    /// Z#20261019
+    ///  the parameter blocks of many dispatches packed into one buffer.
+    /// 1. the buffer has _Frames regions, a frame writes its region only.
+    /// 2. begin() waits the fence of the region, that is _Frames frames ago, then maps it unsynchronized.
+    /// 3. push() copies a block at the next aligned offset and returns the offset, -1 when full.
+    /// 4. end() unmaps. then bind(index, offset) before every dispatch, glBindBufferRange.
+    /// 5. fence() after the last dispatch of the frame.
+    /// 6. _Buffer is GpuUniformBuffer (std140), or GpuShaderStorageBuffer (std430).
+    template<typename _Buffer = GpuUniformBuffer, int _Frames = 3>
+    struct GpuUniformRing
+    {
+        typedef typename _Buffer::traits_type traits_type;
+        
+        _Buffer buffer_;
+        GLsizeiptr frameBytes_ = 0;
+        GLint align_ = 256;
+        int frame_ = -1;
+        GLintptr head_ = 0;
+        unsigned char* vaddr_ = 0;
+        GLsync fences_[_Frames] = {0};
+        
+        ~GpuUniformRing()
+        {
+            for (int i = 0; i < _Frames; ++i)
+            {
+                if (fences_[i])
+                    glDeleteSync(fences_[i]);
+                fences_[i] = 0;
+            }
+        }
+        void alloc(GLsizeiptr frameBytes)
+        {
+            align_ = traits_type::offsetAlignment();
+            frameBytes_ = (frameBytes + align_ - 1) / align_ * align_;
+            buffer_.ensure();
+            buffer_.alloc(frameBytes_ * _Frames, GL_STREAM_DRAW);
+            buffer_.leave();
+        }
+        bool begin()
+        {
+            frame_ = (frame_ + 1) % _Frames;
+            if (fences_[frame_])
+            {
+                glClientWaitSync(fences_[frame_], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+                glDeleteSync(fences_[frame_]);
+                fences_[frame_] = 0;
+            }
+            head_ = 0;
+            buffer_.ensure();
+            vaddr_ = (unsigned char*)buffer_.mmapRange(frame_ * frameBytes_, frameBytes_,
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            buffer_.leave();
+            return vaddr_ != 0;
+        }
+        template<typename _Ty>
+        GLintptr push(const _Ty& block)
+        {
+            static_assert(GpuStd140Block<_Ty>::value, "");
+            if (!vaddr_ || head_ + (GLintptr)sizeof(_Ty) > frameBytes_)
+                return -1;
+            GLintptr offset = head_;
+            memcpy(vaddr_ + offset, &block, sizeof(_Ty));
+            head_ = (offset + sizeof(_Ty) + align_ - 1) / align_ * align_;
+            return frame_ * frameBytes_ + offset;
+        }
+        void end()
+        {
+            if (!vaddr_)
+                return;
+            buffer_.ensure();
+            buffer_.unmap();
+            buffer_.leave();
+            vaddr_ = 0;
+        }
+        /// after end(), offset from push()
+        template<typename _Ty>
+        void bind(GLuint index, GLintptr offset)
+        {
+            buffer_.bindRange(index, offset, sizeof(_Ty));
+        }
+        /// after the last dispatch reading the frame.
+        ///  no frame before the first begin(), nothing to fence.
+        void fence()
+        {
+            if (frame_ < 0)
+                return;
+            if (fences_[frame_])
+                glDeleteSync(fences_[frame_]);
+            fences_[frame_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+    };
+    
+#ifndef GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD
+#define GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD 0x9160
+#endif
+    /// Z#20261019
+    ///  GpuBuffer::copy and GpuBufferImage::copyFromCpuMemory copy the cpu memory to the driver's memory.
+    ///  a host buffer lets the gpu use the cpu memory, no copy.
+    /// 1. importHostMemory(), GL_AMD_pinned_memory. the buffer aliases your memory, it should be 4096 aligned.
+    /// 1.a it is the only vendor thing in this helper, but it is just an enum, no entry.
+    /// 1.b mesa (llvmpipe, radeonsi) supports it.
+    /// 2. allocPersistent(), GL4.4 glBufferStorage with GL_CLIENT_STORAGE_BIT, persistent and coherent mapping.
+    ///    the memory is the driver's, data() is where you produce your data, rather than a staging copy.
+    /// 3. import() tries 1 then 2, for 2 your memory is copied once.
+    /// 4. the storage is immutable, release() before import again.
+    /// 5. the gpu accesses the memory asynchronously, fence() after the draw, wait() before the cpu touches it.
+    template<GLenum _Ty, typename _Traits = GL2::_Traits_GpuBuffer<_Ty> >
+    struct GpuHostBuffer : public GL2::GpuBuffer<_Ty, true, _Traits>
+    {
+        void* host_ = 0;
+        GLsizeiptr size_ = 0;
+        bool pinned_ = false;
+        GLsync sync_ = 0;
+        
+        ~GpuHostBuffer()
+        {
+            if (sync_)
+                glDeleteSync(sync_);
+            sync_ = 0;
+        }
+        static bool pinnable(const void* host)
+        {
+            return host && 0 == ((size_t)host & 4095);
+        }
+        /// ensure() first
+        bool importHostMemory(void* host, GLsizeiptr size)
+        {
+            if (!pinnable(host) || !GpuExtensions::has("GL_AMD_pinned_memory"))
+                return false;
+            while (glGetError() != GL_NO_ERROR)
+                ;
+            glBindBuffer(GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD, this->vbo_);
+            glBufferData(GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD, size, host, GL_STREAM_COPY);
+            glBindBuffer(GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD, 0);
+            glBindBuffer(_Ty, this->vbo_);
+            if (glGetError() != GL_NO_ERROR)
+                return false;
+            host_ = host;
+            size_ = size;
+            pinned_ = true;
+            return true;
+        }
+        /// ensure() first, access GL_MAP_READ_BIT and/or GL_MAP_WRITE_BIT
+        void* allocPersistent(GLsizeiptr size, GLbitfield access = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT)
+        {
+            GLbitfield flags = access | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            /// GL_DYNAMIC_STORAGE_BIT, GpuBuffer::copy still works
+            glBufferStorage(_Ty, size, 0, flags | GL_CLIENT_STORAGE_BIT | GL_DYNAMIC_STORAGE_BIT);
+            host_ = glMapBufferRange(_Ty, 0, size, flags);
+            size_ = host_ ? size : 0;
+            pinned_ = false;
+            return host_;
+        }
+        void* import(void* host, GLsizeiptr size, GLbitfield access = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT)
+        {
+            if (importHostMemory(host, size))
+                return host_;
+            void* vaddr = allocPersistent(size, access);
+            if (vaddr && host)
+                memcpy(vaddr, host, size);
+            return vaddr;
+        }
+        void release()
+        {
+            /// a mapped buffer is unmapped when deleted
+            this->leave();
+            if (this->vbo_)
+                glDeleteBuffers(1, &this->vbo_);
+            this->vbo_ = 0;
+            host_ = 0;
+            size_ = 0;
+            pinned_ = false;
+        }
+        void* data()
+        {
+            return host_;
+        }
+        bool pinned()
+        {
+            return pinned_;
+        }
+        void fence()
+        {
+            if (sync_)
+                glDeleteSync(sync_);
+            sync_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+        bool wait(GLuint64 timeoutNs = 1000000000ull)
+        {
+            if (!sync_)
+                return true;
+            GLenum r = glClientWaitSync(sync_, GL_SYNC_FLUSH_COMMANDS_BIT, timeoutNs);
+            if (r == GL_TIMEOUT_EXPIRED || r == GL_WAIT_FAILED)
+                return false;
+            glDeleteSync(sync_);
+            sync_ = 0;
+            return true;
+        }
+        /// gl writes 4 bytes, then read them back from the host memory, and restore.
+        /// true means the gpu and the cpu see the same memory, no copy.
+        bool verifyAliasing()
+        {
+            if (!host_ || size_ < 4)
+                return false;
+            GLuint saved, probe = 0x5a17c0deu, seen = 0;
+            memcpy(&saved, host_, 4);
+            glBufferSubData(_Ty, 0, 4, &probe);
+            glFinish();
+            memcpy(&seen, host_, 4);
+            glBufferSubData(_Ty, 0, 4, &saved);
+            glFinish();
+            return seen == probe;
+        }
+    };
+    
+    struct GpuHostTexBuffer : public GpuHostBuffer<GL_TEXTURE_BUFFER, _Traits_GpuTexBuffer>
+    {
+        
+    };
+    
+    struct GpuHostPixelBufferDrawable : public GpuHostBuffer<GL_PIXEL_UNPACK_BUFFER>
+    {
+        
+    };
+    
+    struct GpuHostPixelBufferReadable : public GpuHostBuffer<GL_PIXEL_PACK_BUFFER>
+    {
+        
+    };
+    
+    /// Z#20261019
+    ///  glGetBufferSubData and glGetTexImage wait for every gpu command before them.
+    ///  an async readback copies on the gpu into a staging buffer, fences it, and returns at once.
+    ///  the cpu copy happens in ready() or wait(), after the fence.
+    /// 1. issue(), GpuBufferImage::copyToCpuMemoryAsync(), glCopyBufferSubData to the staging buffer.
+    /// 2. issueImage<GL_TEXTURE_2D>(), glGetTexImage to the staging buffer as PBO.
+    /// 3. the staging buffer is kept and grown, one GpuReadback per in-flight readback, reuse it after ready.
+    /// 4. the data pointer must live until ready() returns true or wait() returns.
+    /// 5. not thread safe, poll on the thread of the context.
+    /// 6. a failed wait, map or unmap is kept by failed(), ready() and wait() return false until the next issue.
+    struct GpuReadback
+    {
+        GL2::GpuPixelBufferReadable staging_;
+        GLsizeiptr capacity_ = 0;
+        GLsizeiptr bytes_ = 0;
+        GLvoid* data_ = 0;
+        GLsync sync_ = 0;
+        bool failed_ = false;
+        
+        ~GpuReadback()
+        {
+            if (sync_)
+                glDeleteSync(sync_);
+            sync_ = 0;
+        }
+        bool issue(GLuint buffer, GLintptr offset, GLsizeiptr bytes, GLvoid* data)
+        {
+            if (pending() || !reserve(bytes))
+                return false;
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, staging_.vbo_);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, 0, bytes);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            return fence(bytes, data);
+        }
+        /// the image is ensured by user, bytes is the size of the whole level
+        template<GLenum _Ty, GLint _Lv = 0>
+        bool issueImage(GLenum format, GLenum type, GLsizeiptr bytes, GLvoid* data)
+        {
+            if (pending() || !reserve(bytes))
+                return false;
+            GL2::GpuPixelBufferReadableSaver pbo;
+            staging_.ensure();
+            glGetTexImage(_Ty, _Lv, format, type, 0);
+            staging_.leave();
+            return fence(bytes, data);
+        }
+        bool pending() const
+        {
+            return sync_ != 0;
+        }
+        /// the last readback failed, the wait, the map or the unmap, data was not written.
+        ///  kept until the next issue.
+        bool failed() const
+        {
+            return failed_;
+        }
+        /// never blocks. true when the data has been copied to the cpu memory.
+        ///  false while pending, or when it failed, see failed().
+        bool ready()
+        {
+            if (!sync_)
+                return !failed_;
+            GLenum r = glClientWaitSync(sync_, 0, 0);
+            if (r == GL_TIMEOUT_EXPIRED)
+                return false;
+            return complete(r);
+        }
+        /// blocks up to timeout nanoseconds.
+        bool wait(GLuint64 timeout = GL_TIMEOUT_IGNORED)
+        {
+            if (!sync_)
+                return !failed_;
+            GLenum r = glClientWaitSync(sync_, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+            if (r == GL_TIMEOUT_EXPIRED)
+                return false;
+            return complete(r);
+        }
+    private:
+        bool reserve(GLsizeiptr bytes)
+        {
+            if (bytes <= 0)
+                return false;
+            if (bytes <= capacity_)
+                return true;
+            GL2::GpuPixelBufferReadableSaver pbo;
+            staging_.ensure();
+            staging_.alloc(bytes, GL_STREAM_READ);
+            staging_.leave();
+            capacity_ = bytes;
+            return true;
+        }
+        bool fence(GLsizeiptr bytes, GLvoid* data)
+        {
+            bytes_ = bytes;
+            data_ = data;
+            sync_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            failed_ = sync_ == 0;
+            /// so ready() alone can see the fence signaled
+            glFlush();
+            return sync_ != 0;
+        }
+        /// Z#20261019 bug
+        ///  a failed wait or map deleted sync_ only, the next ready() or wait() returned true.
+        bool complete(GLenum r)
+        {
+            glDeleteSync(sync_);
+            sync_ = 0;
+            failed_ = true;
+            if (r == GL_WAIT_FAILED)
+                return false;
+            GL2::GpuPixelBufferReadableSaver pbo;
+            staging_.ensure();
+            void* vaddr = staging_.mmapRange(0, bytes_, GL_MAP_READ_BIT);
+            if (vaddr)
+            {
+                memcpy(data_, vaddr, bytes_);
+                failed_ = !staging_.unmap();
+            }
+            staging_.leave();
+            return !failed_;
+        }
+    };
+    
+    /// buffer texture can not attach to FBO
+    /// buffer texture is 1D array.
+    /// Z#20240118 doc
+    ///  PBO and GL_TEXTURE_BUFFER are buffers can bind to a sort of TEXURE with the same name GL_TEXTURE_BUFFER
+    /// carefully
+    ///  buffer of GL_TEXTURE_BUFFER
+    ///  texture of GL_TEXTURE_BUFFER
+    struct GpuBufferImage : public GpuImage<GL_TEXTURE_BUFFER>
+    {
+        GpuTexBuffer self_buf_;
+        void ensure(GLuint n = 0)
+        {
+            if (self_buf_.vbo_)
+                self_buf_.ensure();
+            GpuImage::ensure(n);
+        }
+        /// Z#20240118 add pbo
+        void attach(GLint internalFormat, GL2::GpuPixelBufferReadable& pbo)
+        {
+            alloc(internalFormat, pbo.vbo_);
+        }
+        void attach(GLint internalFormat, GL2::GpuPixelBufferDrawable& pbo)
+        {
+            alloc(internalFormat, pbo.vbo_);
+        }
+        /// Z#20261019 the texels are in the host memory, see GpuHostBuffer
+        void attach(GLint internalFormat, GpuHostTexBuffer& buf)
+        {
+            alloc(internalFormat, buf.vbo_);
+        }
+        void alloc(GLint internalFormat, GLuint buffer)
+        {
+            /// the buffer is ensured by user
+            /// Z#20240118
+            ///  attenuation!!!
+            ///  the buffer can be GL_TEXTRUE_BUFFER or PBO
+            glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, buffer);
+        }
+        void alloc(GLint internalFormat, GLsizeiptr bytes, GLenum usage = GL_STATIC_READ)
+        {
+            self_buf_.ensure();
+            self_buf_.alloc(bytes, usage);
+            alloc(internalFormat, self_buf_.vbo_); 
+            // self_buf_.leave();
+        }
+        void alloc(GLint internalFormat, GLsizeiptr bytes, const GLvoid* data, GLenum usage = GL_STATIC_READ)
+        {
+            self_buf_.ensure();
+            self_buf_.alloc(bytes, data, usage);
+            alloc(internalFormat, self_buf_.vbo_);
+            // self_buf_.leave();
+        }
+        void copyFromCpuMemory(GLintptr offset, GLsizeiptr bytes, const GLvoid* data)
+        {
+            GpuTexBufferHandle handle;
+            handle.vbo_ = bufferId();
+            handle.copy(offset, bytes, data);
+        }
+        void copyFromCpuMemory(GLsizeiptr bytes, const GLvoid* data)
+        {
+            GpuTexBufferHandle handle;
+            handle.vbo_ = bufferId();
+            handle.copy(0, bytes, data);
+        }
+        void copyToCpuMemory(GLintptr offset, GLsizeiptr bytes, GLvoid* data)
+        {
+            GpuTexBufferHandle handle;
+            handle.vbo_ = bufferId();
+            handle.copyTo(offset, bytes, data);
+        }
+        void copyToCpuMemory(GLsizeiptr bytes, GLvoid* data)
+        {
+            GpuTexBufferHandle handle;
+            handle.vbo_ = bufferId();
+            handle.copyTo(0, bytes, data);
+        }
+        /// Z#20261019
+        ///  hides glReadPixels of the base class, buffer texture can not attach to FBO.
+        ///  was an empty body, it copied nothing. the texels are 1D, copy by offset and bytes.
+        void copyToCpuMemory(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid* cpumem) = delete;
+        /// Z#20261019
+        ///  returns at once, poll readback.ready() or readback.wait() later, see GpuReadback.
+        bool copyToCpuMemoryAsync(GpuReadback& readback, GLintptr offset, GLsizeiptr bytes, GLvoid* data)
+        {
+            return readback.issue(dataStore(), offset, bytes, data);
+        }
+        bool copyToCpuMemoryAsync(GpuReadback& readback, GLsizeiptr bytes, GLvoid* data)
+        {
+            return readback.issue(dataStore(), 0, bytes, data);
+        }
+        /// Z#20261019 the buffer of the texels, self_buf_, or the pbo or host buffer attached.
+        ///  bufferId() is the texture, GL_TEXTURE_BINDING_BUFFER.
+        GLuint dataStore()
+        {
+            if (self_buf_.vbo_)
+                return self_buf_.vbo_;
+            GLint bound = 0;
+            glGetIntegerv(GL_TEXTURE_BINDING_BUFFER, &bound);
+            if ((GLuint)bound != tex_)
+                glBindTexture(GL_TEXTURE_BUFFER, tex_);
+            GLint buffer = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_BUFFER, 0, GL_TEXTURE_BUFFER_DATA_STORE_BINDING, &buffer);
+            if ((GLuint)bound != tex_)
+                glBindTexture(GL_TEXTURE_BUFFER, bound);
+            return (GLuint)buffer;
+        }
+        /// Z#20261019
+        ///  typed formats, see GpuFormat. offset and count are in texels.
+        ///  the conversion writes into the mapped buffer directly, no staging copy.
+        template<typename _Fmt>
+        void allocFormat(GLsizeiptr texels, GLenum usage = GL_STATIC_READ)
+        {
+            alloc(_Fmt::internalFormat, texels * _Fmt::texelBytes, usage);
+        }
+        /// Z#20261019 bug
+        ///  mapped bufferId(), the texture name, GL_INVALID_OPERATION once another buffer was bound
+        ///  to GL_TEXTURE_BUFFER. the data store is mapped now, false when the map or unmap fails.
+        template<typename _Fmt>
+        bool copyFromFloatMemory(GLintptr texelOffset, GLsizeiptr texels, const float* data)
+        {
+            GLuint buffer = dataStore();
+            if (!buffer)
+                return false;
+            DataStoreSaver store(buffer);
+            void* vaddr = store.handle_.mmapRange(texelOffset * _Fmt::texelBytes, texels * _Fmt::texelBytes,
+                                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+            if (!vaddr)
+                return false;
+            _Fmt::fromFloat(data, (typename _Fmt::host_type*)vaddr, texels * _Fmt::channels);
+            return store.handle_.unmap();
+        }
+        template<typename _Fmt>
+        bool copyToFloatMemory(GLintptr texelOffset, GLsizeiptr texels, float* data)
+        {
+            GLuint buffer = dataStore();
+            if (!buffer)
+                return false;
+            DataStoreSaver store(buffer);
+            void* vaddr = store.handle_.mmapRange(texelOffset * _Fmt::texelBytes, texels * _Fmt::texelBytes,
+                                                  GL_MAP_READ_BIT);
+            if (!vaddr)
+                return false;
+            _Fmt::toFloat((const typename _Fmt::host_type*)vaddr, data, texels * _Fmt::channels);
+            return store.handle_.unmap();
+        }
+        /// binds the data store to GL_TEXTURE_BUFFER, the previous buffer is bound back
+        struct DataStoreSaver
+        {
+            GpuTexBufferHandle handle_;
+            GLint bound_;
+            
+            DataStoreSaver(GLuint buffer)
+            {
+                bound_ = GpuTexBufferHandle::queryCurrentBinding();
+                handle_.vbo_ = buffer;
+                handle_.ensure();
+            }
+            ~DataStoreSaver()
+            {
+                glBindBuffer(GL_TEXTURE_BUFFER, bound_);
+            }
+        };
+        GLint maxSize()
+        {
+            GLint size;
+            glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &size);
+            return size;
+        }
+        GLint bufferId()
+        {
+            /// Z#20220413 bug GL_TEXTURE_BINDING_BUFFER
+            ///   GL_TEXTURE_BINDING_BUFFER get the texid or bufid ?
+            /// 1. get the current texid which glBindTexture to GL_TEXTURE_BUFFER 
+            /// 2. get the current bufid which glBindBuffer to GL_TEXTURE_BUFFER
+            GLint bufid;
+            glGetIntegerv(GL_TEXTURE_BINDING_BUFFER, &bufid);
+            return bufid;
+        }
+        
+        void setGP()
+        {
+            /// do nothing
+        }
+        
+        static const char* glslType()
+        {
+            return "samplerBuffer";
+        }
+    };
+    
+    /// this is the general default framebuffer which is called window-system-provided framebuffer.
+    /// http://www.songho.ca/opengl/gl_fbo.html#:~:text=By%20default%2C%20OpenGL%20uses%20the,window%2Dsystem%2Dprovided%20framebuffer.
+    /// https://www.khronos.org/opengl/wiki/Framebuffer
+    struct GpuRenderDevice
+    {
+        void ensure()
+        {
+            /// Z#20220421 bug
+            ///  0 is not the default framebuffer, it just unbind anything.
+            ///  1 would be the default framebuffer. 
+            ///  but i have no idea about NV or ATI drivers.
+            /// thanks to https://stackoverflow.com/questions/11617013/why-would-glbindframebuffergl-framebuffer-0-result-in-blank-screen-in-cocos2d
+            glBindFramebuffer(GL_FRAMEBUFFER, 1);
+        }
+        static void openReadOnFront()
         {
             glReadBuffer(GL_FRONT);
         }
@@ -1508,6 +3011,62 @@ namespace GL3
         }
     };
     
+    /// Z#20261019
+    ///  the storage of a FBO port which is never sampled, no texture, no mipmap, no sampler state.
+    /// 1. color outputs which are only read back or blitted, depth and stencil for early-Z/stencil culling.
+    /// 2. allocMultisample(), MSAA storage, resolve it by glBlitFramebuffer (GpuCopyEngine does textures only).
+    /// 3. pin it by GpuFBODevice::color0PinGpuRenderBuffer, depthPinGpuRenderBuffer, ...
+    struct GpuRenderBuffer
+    {
+        GLuint rbo_ = 0;
+        
+        ~GpuRenderBuffer()
+        {
+            if (rbo_)
+                glDeleteRenderbuffers(1, &rbo_);
+            rbo_ = 0;
+        }
+        static int queryCurrentBinding()
+        {
+            GLint rbo = 0;
+            glGetIntegerv(GL_RENDERBUFFER_BINDING, &rbo);
+            return rbo;
+        }
+        void ensure()
+        {
+            if (!rbo_)
+                glGenRenderbuffers(1, &rbo_);
+            glBindRenderbuffer(GL_RENDERBUFFER, rbo_);
+        }
+        void leave()
+        {
+            if (queryCurrentBinding() == (GLint)rbo_)
+                glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        }
+        /// GL_RGBA8, GL_R32F, GL_DEPTH_COMPONENT24, GL_DEPTH24_STENCIL8, GL_STENCIL_INDEX8, ...
+        void alloc(GLenum internalFormat, GLsizei width, GLsizei height)
+        {
+            glRenderbufferStorage(GL_RENDERBUFFER, internalFormat, width, height);
+        }
+        /// samples is rounded up by the driver, see samples()
+        void allocMultisample(GLsizei samples, GLenum internalFormat, GLsizei width, GLsizei height)
+        {
+            glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, internalFormat, width, height);
+        }
+        GLint samples()
+        {
+            GLint n = 0;
+            glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_SAMPLES, &n);
+            return n;
+        }
+        static GLint maxSamples()
+        {
+            GLint n = 0;
+            glGetIntegerv(GL_MAX_SAMPLES, &n);
+            return n;
+        }
+    };
+    
     template<GLenum _Device = GL_FRAMEBUFFER>
     struct GpuFBODevice
     {
@@ -1524,7 +3083,9 @@ namespace GL3
         ~GpuFBODevice()
         {
             leave();
-            if (!fbo_)
+            /// Z#20261019 bug
+            ///  it was `if (!fbo_)`, every FBO leaked.
+            if (fbo_)
                 glDeleteFramebuffers(1, &fbo_);
             fbo_ = 0;
         }
@@ -1567,6 +3128,19 @@ namespace GL3
         {   \
             glFramebufferTexture2D(_Device, GL_COLOR_ATTACHMENT##_N_, GL_TEXTURE_2D, image.tex_, level);    \
         }   \
+        void color##_N_##PinGpuImageRect(GpuImageRect& image)   \
+        {   \
+            glFramebufferTexture2D(_Device, GL_COLOR_ATTACHMENT##_N_, GL_TEXTURE_RECTANGLE, image.tex_, 0);    \
+        }   \
+        template<GLenum _Ty>  \
+        void color##_N_##PinGpuImageLayer(GpuImage<_Ty>& image, GLint layer, GLint level = 0)   \
+        {   \
+            glFramebufferTextureLayer(_Device, GL_COLOR_ATTACHMENT##_N_, image.tex_, level, layer); \
+        }   \
+        void color##_N_##PinGpuRenderBuffer(GpuRenderBuffer& rb)   \
+        {   \
+            glFramebufferRenderbuffer(_Device, GL_COLOR_ATTACHMENT##_N_, GL_RENDERBUFFER, rb.rbo_);    \
+        }   \
         void color##_N_##PinGpuImage(GpuBufferImage&, GLint level = 0) = delete;
         COLOR_N_PIN_TEX(0);
         COLOR_N_PIN_TEX(1);
@@ -1585,8 +3159,1108 @@ namespace GL3
         COLOR_N_PIN_TEX(14);
         COLOR_N_PIN_TEX(15);
 #undef COLOR_N_PIN_TEX
+        /// Z#20261019
+        ///  depth and stencil ports. GL_DEPTH24_STENCIL8 goes to the depthStencil port.
+        void depthPinGpuRenderBuffer(GpuRenderBuffer& rb)
+        {
+            glFramebufferRenderbuffer(_Device, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rb.rbo_);
+        }
+        void stencilPinGpuRenderBuffer(GpuRenderBuffer& rb)
+        {
+            glFramebufferRenderbuffer(_Device, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rb.rbo_);
+        }
+        void depthStencilPinGpuRenderBuffer(GpuRenderBuffer& rb)
+        {
+            glFramebufferRenderbuffer(_Device, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rb.rbo_);
+        }
+        /// a depth texture, GL_DEPTH_COMPONENT32F etc., when the depth is sampled later
+        void depthPinGpuImage2D(GpuImage2D& image, GLint level = 0)
+        {
+            glFramebufferTexture2D(_Device, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, image.tex_, level);
+        }
+        void depthStencilPinGpuImage2D(GpuImage2D& image, GLint level = 0)
+        {
+            glFramebufferTexture2D(_Device, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, image.tex_, level);
+        }
+        void unpinDepthStencil()
+        {
+            glFramebufferRenderbuffer(_Device, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, 0);
+        }
+        /// the FBO should be ensured
+        static GLenum status()
+        {
+            return glCheckFramebufferStatus(_Device);
+        }
+        static bool complete()
+        {
+            return status() == GL_FRAMEBUFFER_COMPLETE;
+        }
+        static void clearDepthStencil(GLfloat depth = 1.0f, GLint stencil = 0)
+        {
+            glClearBufferfi(GL_DEPTH_STENCIL, 0, depth, stencil);
+        }
+    };
+    
+    /// Z#20261019
+    ///  switching among dozens of targets, pin then revalidate, every time.
+    ///  the cache keeps one FBO per attachment set, pinned and checked once.
+    /// 1. Key, the attachments, port + texture or render buffer + level + layer.
+    ///    key.color(0, image).depthStencil(rb), the order of calls does not matter.
+    /// 2. acquire(key) binds the FBO of the key, made, pinned and checked by glCheckFramebufferStatus
+    ///    at the first time. 0 when incomplete, the status is kept, no check again.
+    /// 3. the draw buffers are the color ports of the key, set once, they are FBO state.
+    /// 4. the binding is tracked by the cache, no glGetIntegerv, release() to bind 0.
+    ///    do not bind other FBOs between acquire() and release(), or call forget().
+    /// 5. a texture deleted is still pinned in a cached FBO, evict(tex) before, or clear().
+    /// 6. at most capacity_ FBOs, the least recently acquired is deleted.
+    struct GpuFBOCache
+    {
+        struct Attachment
+        {
+            GLenum port_;
+            GLuint name_;
+            GLint level_;
+            GLint layer_;           /// -1, the whole texture, layered for arrays
+            bool renderbuffer_;
+            
+            bool operator<(const Attachment& o) const
+            {
+                if (port_ != o.port_) return port_ < o.port_;
+                if (name_ != o.name_) return name_ < o.name_;
+                if (level_ != o.level_) return level_ < o.level_;
+                if (layer_ != o.layer_) return layer_ < o.layer_;
+                return renderbuffer_ < o.renderbuffer_;
+            }
+        };
+        struct Key
+        {
+            std::vector<Attachment> attachments_;
+            
+            template<GLenum _Ty>
+            Key& color(GLint i, GpuImage<_Ty>& image, GLint level = 0, GLint layer = -1)
+            {
+                return add(GL_COLOR_ATTACHMENT0 + i, image.tex_, level, layer, false);
+            }
+            Key& color(GLint i, GpuRenderBuffer& rb)
+            {
+                return add(GL_COLOR_ATTACHMENT0 + i, rb.rbo_, 0, -1, true);
+            }
+            Key& depth(GpuRenderBuffer& rb)
+            {
+                return add(GL_DEPTH_ATTACHMENT, rb.rbo_, 0, -1, true);
+            }
+            Key& depth(GpuImage2D& image, GLint level = 0)
+            {
+                return add(GL_DEPTH_ATTACHMENT, image.tex_, level, -1, false);
+            }
+            Key& stencil(GpuRenderBuffer& rb)
+            {
+                return add(GL_STENCIL_ATTACHMENT, rb.rbo_, 0, -1, true);
+            }
+            Key& depthStencil(GpuRenderBuffer& rb)
+            {
+                return add(GL_DEPTH_STENCIL_ATTACHMENT, rb.rbo_, 0, -1, true);
+            }
+            bool operator<(const Key& o) const
+            {
+                return attachments_ < o.attachments_;
+            }
+        private:
+            Key& add(GLenum port, GLuint name, GLint level, GLint layer, bool renderbuffer)
+            {
+                Attachment a = {port, name, level, layer, renderbuffer};
+                attachments_.insert(std::upper_bound(attachments_.begin(), attachments_.end(), a), a);
+                return *this;
+            }
+        };
+        struct Entry
+        {
+            GLuint fbo_;
+            GLenum status_;
+            unsigned long long used_;
+        };
+        
+        std::map<Key, Entry> entries_;
+        size_t capacity_ = 64;
+        GLuint current_ = 0;
+        unsigned long long clock_ = 0;
+        size_t checks_ = 0;         /// glCheckFramebufferStatus calls, for statistics
+        
+        ~GpuFBOCache()
+        {
+            clear();
+        }
+        GLuint acquire(const Key& key)
+        {
+            std::map<Key, Entry>::iterator it = entries_.find(key);
+            if (it == entries_.end())
+            {
+                if (entries_.size() >= capacity_)
+                    evictOldest();
+                it = entries_.insert(std::make_pair(key, make(key))).first;
+            }
+            it->second.used_ = ++clock_;
+            if (it->second.status_ != GL_FRAMEBUFFER_COMPLETE)
+                return 0;
+            if (current_ != it->second.fbo_)
+            {
+                glBindFramebuffer(GL_FRAMEBUFFER, it->second.fbo_);
+                current_ = it->second.fbo_;
+            }
+            return current_;
+        }
+        /// GL_FRAMEBUFFER_COMPLETE, or the reason, checked once per key
+        GLenum status(const Key& key)
+        {
+            std::map<Key, Entry>::iterator it = entries_.find(key);
+            return (it == entries_.end()) ? GL_NONE : it->second.status_;
+        }
+        void release()
+        {
+            if (current_)
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            current_ = 0;
+        }
+        /// others have bound a FBO
+        void forget()
+        {
+            current_ = 0;
+        }
+        /// the FBOs of a texture or a render buffer
+        void evict(GLuint name)
+        {
+            for (std::map<Key, Entry>::iterator it = entries_.begin(); it != entries_.end();)
+            {
+                bool pinned = false;
+                for (size_t i = 0; i < it->first.attachments_.size(); ++i)
+                    pinned = pinned || it->first.attachments_[i].name_ == name;
+                if (pinned)
+                {
+                    destroy(it->second);
+                    it = entries_.erase(it);
+                }
+                else
+                    ++it;
+            }
+        }
+        void clear()
+        {
+            for (std::map<Key, Entry>::iterator it = entries_.begin(); it != entries_.end(); ++it)
+                destroy(it->second);
+            entries_.clear();
+        }
+        size_t size() const
+        {
+            return entries_.size();
+        }
+    private:
+        /// an incomplete FBO is left unbound, the binding before make() is restored
+        Entry make(const Key& key)
+        {
+            Entry e = {0, GL_NONE, 0};
+            GLint previous = 0;
+            glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+            glGenFramebuffers(1, &e.fbo_);
+            glBindFramebuffer(GL_FRAMEBUFFER, e.fbo_);
+            current_ = e.fbo_;
+            GLenum ports[16];
+            GLsizei n = 0;
+            for (size_t i = 0; i < key.attachments_.size(); ++i)
+            {
+                const Attachment& a = key.attachments_[i];
+                if (a.renderbuffer_)
+                    glFramebufferRenderbuffer(GL_FRAMEBUFFER, a.port_, GL_RENDERBUFFER, a.name_);
+                else if (a.layer_ < 0)
+                    glFramebufferTexture(GL_FRAMEBUFFER, a.port_, a.name_, a.level_);
+                else
+                    glFramebufferTextureLayer(GL_FRAMEBUFFER, a.port_, a.name_, a.level_, a.layer_);
+                if (a.port_ >= GL_COLOR_ATTACHMENT0 && a.port_ < GL_COLOR_ATTACHMENT0 + 16 && n < 16)
+                    ports[n++] = a.port_;
+            }
+            if (n)
+                glDrawBuffers(n, ports);
+            else
+                glDrawBuffer(GL_NONE);
+            e.status_ = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+            ++checks_;
+            if (e.status_ != GL_FRAMEBUFFER_COMPLETE)
+            {
+                glBindFramebuffer(GL_FRAMEBUFFER, previous);
+                /// the cache tracks only its own FBOs
+                current_ = 0;
+                for (std::map<Key, Entry>::iterator it = entries_.begin(); it != entries_.end(); ++it)
+                    if (it->second.fbo_ == (GLuint)previous)
+                        current_ = previous;
+            }
+            return e;
+        }
+        void destroy(Entry& e)
+        {
+            if (current_ == e.fbo_)
+            {
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                current_ = 0;
+            }
+            if (e.fbo_)
+                glDeleteFramebuffers(1, &e.fbo_);
+            e.fbo_ = 0;
+        }
+        void evictOldest()
+        {
+            std::map<Key, Entry>::iterator oldest = entries_.begin();
+            for (std::map<Key, Entry>::iterator it = entries_.begin(); it != entries_.end(); ++it)
+                if (it->second.used_ < oldest->second.used_)
+                    oldest = it;
+            if (oldest != entries_.end())
+            {
+                destroy(oldest->second);
+                entries_.erase(oldest);
+            }
+        }
+    };
+    
+    /// Z#20261019
+    ///  GL2 drawing (GLFixedPipelineClient, Lighting, Material) without a window.
+    ///  GpuRenderDevice front/back buffers need a windowed context, the offscreen target does not.
+    /// 1. color and depth/stencil are multisample render buffers, samples <= GpuRenderBuffer::maxSamples().
+    /// 2. begin() binds the MSAA FBO and sets the viewport, then draw as on the default framebuffer.
+    /// 3. end() resolves by glBlitFramebuffer into image_, a GpuImage2D (GL_RGBA8), sample it or capture it.
+    /// 4. samples 0, no MSAA, the color is drawn to image_ directly, end() resolves nothing.
+    /// 5. the fixed pipeline needs a compatibility context, GpuContext::createGL(major, minor, false).
+    struct GpuOffscreenTarget
+    {
+        GpuRenderBuffer color_;
+        GpuRenderBuffer depth_;
+        GpuImage2D image_;
+        GpuFBODevice<> msaa_;
+        GpuFBODevice<> resolve_;
+        GLsizei width_ = 0;
+        GLsizei height_ = 0;
+        GLsizei samples_ = 0;
+        GLint viewport_[4];
+        
+        bool alloc(GLsizei width, GLsizei height, GLsizei samples = 4)
+        {
+            width_ = width;
+            height_ = height;
+            samples_ = std::min<GLsizei>(samples, GpuRenderBuffer::maxSamples());
+            image_.ensure();
+            image_.setGP();
+            /// mutable storage, alloc() again on resize
+            image_.alloc(GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+            /// unbound, a fixed pipeline GL_TEXTURE_2D must not sample its own target
+            glBindTexture(GL_TEXTURE_2D, 0);
+            resolve_.ensure();
+            resolve_.color0PinGpuImage2D(image_);
+            bool ok = resolve_.complete();
+            resolve_.leave();
+            if (!samples_)
+            {
+                depth_.ensure();
+                depth_.alloc(GL_DEPTH24_STENCIL8, width, height);
+                depth_.leave();
+                resolve_.ensure();
+                resolve_.depthStencilPinGpuRenderBuffer(depth_);
+                ok = ok && resolve_.complete();
+                resolve_.leave();
+                return ok;
+            }
+            color_.ensure();
+            color_.allocMultisample(samples_, GL_RGBA8, width, height);
+            depth_.ensure();
+            depth_.allocMultisample(samples_, GL_DEPTH24_STENCIL8, width, height);
+            depth_.leave();
+            msaa_.ensure();
+            msaa_.color0PinGpuRenderBuffer(color_);
+            msaa_.depthStencilPinGpuRenderBuffer(depth_);
+            ok = ok && msaa_.complete();
+            msaa_.leave();
+            return ok;
+        }
+        void begin()
+        {
+            glGetIntegerv(GL_VIEWPORT, viewport_);
+            if (samples_)
+            {
+                msaa_.ensure();
+                glEnable(GL_MULTISAMPLE);
+            }
+            else
+                resolve_.ensure();
+            GpuFBODevice<>::openDrawCurrentFBO(0);
+            glViewport(0, 0, width_, height_);
+        }
+        void end()
+        {
+            if (samples_)
+            {
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, msaa_.fbo_);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolve_.fbo_);
+                glBlitFramebuffer(0, 0, width_, height_, 0, 0, width_, height_, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            }
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(viewport_[0], viewport_[1], viewport_[2], viewport_[3]);
+        }
+    };
+    
+    /// Z#20261019
+    ///  glReadPixels to the cpu memory blocks on every frame grab.
+    ///  the capture reads the resolved image into a ring of PBOs, and delivers frames when their fences pass.
+    /// 1. capture() after GpuOffscreenTarget::end(), glReadPixels to the PBO of the slot, then a fence.
+    ///    or capture(x, y, width, height) of the current read framebuffer, the size may change per frame.
+    /// 2. poll() delivers every finished frame in order, never blocks.
+    /// 3. a slot is reused after _Depth frames, if its frame is not delivered yet, it is waited and delivered first.
+    ///    so a deeper ring, less stall.
+    /// 4. sink_(frame, rgba, width, height), rgba is the mapped PBO, valid only in the call,
+    ///    rows are bottom up, as glReadPixels.
+    /// 5. lend mode, for readers on other threads, see GpuCaptureEncoder of zcapture_helper.h.
+    /// 5.a lend_(slot, frame, rgba, width, height) instead of sink_, the PBO stays mapped after the call.
+    /// 5.b reclaim_(slot, block) tells the lent slot is read, the ring unmaps it, all gl calls stay on this thread.
+    ///     poll() asks without blocking, capture() on the slot and flush() block.
+    /// 5.c the owner reclaims every lent slot before the ring is destroyed, flush() does it.
+    template<int _Depth = 3>
+    struct GpuFrameCapture
+    {
+        typedef std::function<void(unsigned long long, const unsigned char*, GLsizei, GLsizei)> Sink;
+        typedef std::function<void(int, unsigned long long, const unsigned char*, GLsizei, GLsizei)> Lend;
+        typedef std::function<bool(int, bool)> Reclaim;
+        
+        GL2::GpuPixelBufferReadable pbos_[_Depth];
+        GLsizeiptr capacity_[_Depth] = {0};
+        GLsync fences_[_Depth] = {0};
+        unsigned long long frames_[_Depth] = {0};
+        GLsizei widths_[_Depth] = {0};
+        GLsizei heights_[_Depth] = {0};
+        bool lent_[_Depth] = {false};
+        GLsizei width_ = 0;                 /// of the last capture
+        GLsizei height_ = 0;
+        unsigned long long next_ = 0;       /// the next frame to capture
+        unsigned long long delivered_ = 0;  /// the next frame to deliver
+        Sink sink_;
+        Lend lend_;
+        Reclaim reclaim_;
+        
+        ~GpuFrameCapture()
+        {
+            for (int i = 0; i < _Depth; ++i)
+            {
+                if (fences_[i])
+                    glDeleteSync(fences_[i]);
+                fences_[i] = 0;
+            }
+        }
+        unsigned long long capture(GpuOffscreenTarget& target)
+        {
+            GLint read = 0;
+            glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, target.resolve_.fbo_);
+            glReadBuffer(GL_COLOR_ATTACHMENT0);
+            unsigned long long frame = capture(0, 0, target.width_, target.height_);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, read);
+            return frame;
+        }
+        /// the rgba of the current read framebuffer, GL_COLOR_ATTACHMENT0 of a FBO or GL_BACK
+        unsigned long long capture(GLint x, GLint y, GLsizei width, GLsizei height)
+        {
+            int slot = (int)(next_ % _Depth);
+            if (fences_[slot])
+                deliver(slot, true);
+            if (lent_[slot])
+                reclaim(slot, true);
+            GLsizeiptr bytes = (GLsizeiptr)width * height * 4;
+            pbos_[slot].ensure();
+            if (capacity_[slot] < bytes)
+            {
+                pbos_[slot].alloc(bytes, GL_STREAM_READ);
+                capacity_[slot] = bytes;
+            }
+            {
+                GL2::GpuPixelStoreSaver<GL_PACK_ALIGNMENT> align(4);
+                glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+            }
+            pbos_[slot].leave();
+            fences_[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();
+            frames_[slot] = next_;
+            widths_[slot] = width_ = width;
+            heights_[slot] = height_ = height;
+            return next_++;
+        }
+        /// the number of frames delivered
+        size_t poll()
+        {
+            size_t n = 0;
+            while (delivered_ < next_ && deliver((int)(delivered_ % _Depth), false))
+                ++n;
+            for (int i = 0; i < _Depth; ++i)
+                if (lent_[i])
+                    reclaim(i, false);
+            return n;
+        }
+        /// waits and delivers every frame in flight, and reclaims every lent slot
+        void flush()
+        {
+            while (delivered_ < next_)
+                deliver((int)(delivered_ % _Depth), true);
+            for (int i = 0; i < _Depth; ++i)
+                if (lent_[i])
+                    reclaim(i, true);
+        }
+        size_t pending() const
+        {
+            return (size_t)(next_ - delivered_);
+        }
+        /// pending, and lent not reclaimed
+        size_t inFlight() const
+        {
+            size_t n = pending();
+            for (int i = 0; i < _Depth; ++i)
+                n += lent_[i];
+            return n;
+        }
+    private:
+        bool deliver(int slot, bool block)
+        {
+            if (!fences_[slot])
+                return false;
+            GLenum r = glClientWaitSync(fences_[slot], block ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, block ? GL_TIMEOUT_IGNORED : 0);
+            if (r == GL_TIMEOUT_EXPIRED)
+                return false;
+            glDeleteSync(fences_[slot]);
+            fences_[slot] = 0;
+            ++delivered_;
+            if (r == GL_WAIT_FAILED || !(sink_ || lend_))
+                return true;
+            pbos_[slot].ensure();
+            const unsigned char* rgba = (const unsigned char*)pbos_[slot].mmapRange(0, (GLsizeiptr)widths_[slot] * heights_[slot] * 4, GL_MAP_READ_BIT);
+            if (rgba && lend_)
+            {
+                lent_[slot] = true;
+                pbos_[slot].leave();
+                lend_(slot, frames_[slot], rgba, widths_[slot], heights_[slot]);
+                return true;
+            }
+            if (rgba)
+            {
+                sink_(frames_[slot], rgba, widths_[slot], heights_[slot]);
+                pbos_[slot].unmap();
+            }
+            pbos_[slot].leave();
+            return true;
+        }
+        void reclaim(int slot, bool block)
+        {
+            if (reclaim_ && !reclaim_(slot, block))
+                return;
+            pbos_[slot].ensure();
+            pbos_[slot].unmap();
+            pbos_[slot].leave();
+            lent_[slot] = false;
+        }
+    };
+    
+    /// Z#20261019
+    ///  stages chained on the gpu, no copyToCpuMemory then copyFromCpuMemory.
+    /// 1. buffer -> buffer, glCopyBufferSubData. GpuBuffer, GpuTexBuffer, PBO, GpuBufferImage.
+    /// 2. image -> image, the same texel size, glCopyImageSubData, GL4.3 or GL_ARB_copy_image.
+    /// 3. image -> image, scaled or converted, glBlitFramebuffer through the two FBOs of the engine.
+    ///    color renderable formats only, not GpuBufferImage.
+    /// 4. image -> buffer, glGetTexImage with the buffer as PBO, buffer -> image, glTexSubImage2D from PBO.
+    ///    the texels are reinterpreted by format and type, e.g. a GpuImage2D to a GpuBufferImage of the same format.
+    /// 5. every binding touched is restored, except GL_COPY_READ_BUFFER and GL_COPY_WRITE_BUFFER.
+    struct GpuCopyEngine
+    {
+        GLuint fbos_[2] = {0, 0};
+        
+        ~GpuCopyEngine()
+        {
+            if (fbos_[0])
+                glDeleteFramebuffers(2, fbos_);
+            fbos_[0] = fbos_[1] = 0;
+        }
+        template<typename _Buffer>
+        static GLuint bufferOf(_Buffer& buf)
+        {
+            return buf.vbo_;
+        }
+        static GLuint bufferOf(GpuBufferImage& image)
+        {
+            return image.dataStore();
+        }
+        
+        static void copyBuffer(GLuint src, GLintptr srcOffset, GLuint dst, GLintptr dstOffset, GLsizeiptr bytes)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, src);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, dst);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, srcOffset, dstOffset, bytes);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
+        template<typename _Src, typename _Dst>
+        static void copyBuffer(_Src& src, GLintptr srcOffset, _Dst& dst, GLintptr dstOffset, GLsizeiptr bytes)
+        {
+            copyBuffer(bufferOf(src), srcOffset, bufferOf(dst), dstOffset, bytes);
+        }
+        
+        template<GLenum _Src, GLenum _Dst>
+        static void copyImage(GpuImage<_Src>& src, GLint srcLevel, GLint srcX, GLint srcY, GLint srcZ,
+                              GpuImage<_Dst>& dst, GLint dstLevel, GLint dstX, GLint dstY, GLint dstZ,
+                              GLsizei width, GLsizei height, GLsizei depth = 1)
+        {
+            glCopyImageSubData(src.tex_, _Src, srcLevel, srcX, srcY, srcZ,
+                               dst.tex_, _Dst, dstLevel, dstX, dstY, dstZ, width, height, depth);
+        }
+        template<GLenum _Src, GLenum _Dst>
+        static void copyImage(GpuImage<_Src>& src, GpuImage<_Dst>& dst, GLsizei width, GLsizei height, GLsizei depth = 1)
+        {
+            copyImage(src, 0, 0, 0, 0, dst, 0, 0, 0, 0, width, height, depth);
+        }
+        
+        /// filter GL_NEAREST or GL_LINEAR, layer for arrays and 3D textures
+        template<GLenum _Src, GLenum _Dst>
+        void blit(GpuImage<_Src>& src, GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1,
+                  GpuImage<_Dst>& dst, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1,
+                  GLenum filter = GL_NEAREST, GLint srcLevel = 0, GLint dstLevel = 0, GLint srcLayer = -1, GLint dstLayer = -1)
+        {
+            if (!fbos_[0])
+                glGenFramebuffers(2, fbos_);
+            GLint read = 0, draw = 0;
+            glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read);
+            glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, fbos_[0]);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos_[1]);
+            pin(GL_READ_FRAMEBUFFER, src.tex_, srcLevel, srcLayer);
+            pin(GL_DRAW_FRAMEBUFFER, dst.tex_, dstLevel, dstLayer);
+            glReadBuffer(GL_COLOR_ATTACHMENT0);
+            GLenum port = GL_COLOR_ATTACHMENT0;
+            glDrawBuffers(1, &port);
+            glBlitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, GL_COLOR_BUFFER_BIT, filter);
+            /// detach, so the engine holds no reference to the textures
+            pin(GL_READ_FRAMEBUFFER, 0, 0, -1);
+            pin(GL_DRAW_FRAMEBUFFER, 0, 0, -1);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, read);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw);
+        }
+        
+        /// the whole level, as format and type, to dst at dstOffset
+        template<GLenum _Ty, typename _Dst>
+        static void imageToBuffer(GpuImage<_Ty>& src, GLint level, GLenum format, GLenum type, _Dst& dst, GLintptr dstOffset = 0)
+        {
+            GLuint buffer = bufferOf(dst);
+            TextureSaver<_Ty, _Traits_TextureBinding<_Ty>::binding> saver(src.tex_);
+            GL2::GpuPixelBufferReadableSaver pbo;
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+            glGetTexImage(_Ty, level, format, type, (GLvoid*)dstOffset);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+        template<typename _Src>
+        static void bufferToImage(_Src& src, GLintptr srcOffset, GpuImage2D& dst, GLint level,
+                                  GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type)
+        {
+            GLuint buffer = bufferOf(src);
+            TextureSaver<GL_TEXTURE_2D, GL_TEXTURE_BINDING_2D> saver(dst.tex_);
+            GL2::GpuPixelBufferDrawableSaver pbo;
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+            glTexSubImage2D(GL_TEXTURE_2D, level, x, y, width, height, format, type, (const GLvoid*)srcOffset);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+    private:
+        template<GLenum _Ty>
+        struct _Traits_TextureBinding;
+        
+        template<GLenum _Ty, GLenum _Binding>
+        struct TextureSaver
+        {
+            GLint handle;
+            ~TextureSaver()
+            {
+                glBindTexture(_Ty, handle);
+            }
+            TextureSaver(GLuint tex)
+            {
+                glGetIntegerv(_Binding, &handle);
+                glBindTexture(_Ty, tex);
+            }
+        };
+        static void pin(GLenum device, GLuint tex, GLint level, GLint layer)
+        {
+            if (layer < 0)
+                glFramebufferTexture(device, GL_COLOR_ATTACHMENT0, tex, level);
+            else
+                glFramebufferTextureLayer(device, GL_COLOR_ATTACHMENT0, tex, level, layer);
+        }
+    };
+#define DECLARE_TEXTURE_BINDING(_Ty, _Binding)  \
+    template<> struct GpuCopyEngine::_Traits_TextureBinding<_Ty> { enum : GLenum { binding = _Binding }; }
+    DECLARE_TEXTURE_BINDING(GL_TEXTURE_2D, GL_TEXTURE_BINDING_2D);
+    DECLARE_TEXTURE_BINDING(GL_TEXTURE_RECTANGLE, GL_TEXTURE_BINDING_RECTANGLE);
+    DECLARE_TEXTURE_BINDING(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BINDING_2D_ARRAY);
+    DECLARE_TEXTURE_BINDING(GL_TEXTURE_3D, GL_TEXTURE_BINDING_3D);
+#undef DECLARE_TEXTURE_BINDING
+    
+    /// Z#20261019
+    ///  the filter of the pipeline. before, QOpenGLShaderProgram did the job for me.
+    ///  the build log is kept in log_ when failed.
+    struct GpuProgram
+    {
+        GLuint program_ = 0;
+        std::string log_;
+        
+        ~GpuProgram()
+        {
+            if (program_)
+                glDeleteProgram(program_);
+            program_ = 0;
+        }
+        bool available()
+        {
+            return program_ && glIsProgram(program_);
+        }
+        void ensure()
+        {
+            glUseProgram(program_);
+        }
+        void leave()
+        {
+            GLint program = 0;
+            glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+            if ((GLuint)program == program_)
+                glUseProgram(0);
+        }
+        bool build(const char* vertexSource, const char* fragmentSource)
+        {
+            const char* sources[] = {vertexSource, fragmentSource};
+            GLenum types[] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER};
+            return link(sources, types, 2);
+        }
+        bool build(const char* vertexSource, const char* geometrySource, const char* fragmentSource)
+        {
+            const char* sources[] = {vertexSource, geometrySource, fragmentSource};
+            GLenum types[] = {GL_VERTEX_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER};
+            return link(sources, types, 3);
+        }
+        bool buildCompute(const char* computeSource)
+        {
+            /// GL4.3 at least
+            GLenum type = GL_COMPUTE_SHADER;
+            return link(&computeSource, &type, 1);
+        }
+        GLint uniform(const char* name)
+        {
+            return glGetUniformLocation(program_, name);
+        }
+        /// the program should be ensured
+        void setUniform1i(const char* name, GLint v)
+        {
+            glUniform1i(uniform(name), v);
+        }
+        void setUniform1f(const char* name, GLfloat v)
+        {
+            glUniform1f(uniform(name), v);
+        }
+        void setUniform2i(const char* name, GLint x, GLint y)
+        {
+            glUniform2i(uniform(name), x, y);
+        }
+        void setUniform4fv(const char* name, const GLfloat* v4f)
+        {
+            glUniform4fv(uniform(name), 1, v4f);
+        }
+        /// Z#20261019
+        ///  the block `name` reads the uniform buffer bound to index, see GpuUniformRing.
+        bool bindUniformBlock(const char* name, GLuint index)
+        {
+            GLuint block = glGetUniformBlockIndex(program_, name);
+            if (block == GL_INVALID_INDEX)
+                return false;
+            glUniformBlockBinding(program_, block, index);
+            return true;
+        }
+        /// GL_UNIFORM_BLOCK_DATA_SIZE, compare it with sizeof your std140 struct, -1 when no such block
+        GLint uniformBlockSize(const char* name)
+        {
+            GLuint block = glGetUniformBlockIndex(program_, name);
+            if (block == GL_INVALID_INDEX)
+                return -1;
+            GLint size = 0;
+            glGetActiveUniformBlockiv(program_, block, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+            return size;
+        }
+    private:
+        bool link(const char* const* sources, const GLenum* types, int n)
+        {
+            log_.clear();
+            if (program_)
+                glDeleteProgram(program_);
+            program_ = glCreateProgram();
+            GLuint shaders[3] = {0};
+            bool ok = true;
+            for (int i = 0; i < n && ok; ++i)
+            {
+                shaders[i] = glCreateShader(types[i]);
+                glShaderSource(shaders[i], 1, &sources[i], 0);
+                glCompileShader(shaders[i]);
+                GLint status = 0;
+                glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &status);
+                if (!status)
+                {
+                    appendLog(shaders[i], false);
+                    ok = false;
+                }
+                glAttachShader(program_, shaders[i]);
+            }
+            if (ok)
+            {
+                glLinkProgram(program_);
+                GLint status = 0;
+                glGetProgramiv(program_, GL_LINK_STATUS, &status);
+                if (!status)
+                {
+                    appendLog(program_, true);
+                    ok = false;
+                }
+            }
+            /// shaders are flagged, deleted with the program
+            for (int i = 0; i < n; ++i)
+            {
+                if (shaders[i])
+                    glDeleteShader(shaders[i]);
+            }
+            if (!ok)
+            {
+                glDeleteProgram(program_);
+                program_ = 0;
+            }
+            return ok;
+        }
+        void appendLog(GLuint object, bool program)
+        {
+            GLint len = 0;
+            if (program)
+                glGetProgramiv(object, GL_INFO_LOG_LENGTH, &len);
+            else
+                glGetShaderiv(object, GL_INFO_LOG_LENGTH, &len);
+            if (len <= 0)
+                return;
+            std::string log(len, '\0');
+            if (program)
+                glGetProgramInfoLog(object, len, 0, &log[0]);
+            else
+                glGetShaderInfoLog(object, len, 0, &log[0]);
+            log_.append(log.c_str());
+        }
     };
 
+    /// Z#20261019
+    ///  saves the viewport and the scissor, a pass may draw to a part of the output.
+    struct GpuViewportSaver
+    {
+        GLint viewport[4];
+        GLint scissor[4];
+        GLboolean scissorTest;
+        ~GpuViewportSaver()
+        {
+            glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+            glScissor(scissor[0], scissor[1], scissor[2], scissor[3]);
+            if (!scissorTest)
+                glDisable(GL_SCISSOR_TEST);
+        }
+        GpuViewportSaver()
+        {
+            glGetIntegerv(GL_VIEWPORT, viewport);
+            glGetIntegerv(GL_SCISSOR_BOX, scissor);
+            scissorTest = glIsEnabled(GL_SCISSOR_TEST);
+        }
+    };
+    
+    /// Z#20261019
+    ///  the gpgpu pass, instead of a quad vbo of the caller, glViewport and the pins by hand.
+    ///  GL_QUADS has gone since 3.1 core.
+    /// 1. one triangle without any attribute, made of gl_VertexID, covers the viewport.
+    ///    core profile draws nothing without a vao, the launcher owns an empty one.
+    /// 2. the viewport and the scissor are the output region, no fragment out of it,
+    ///    a partial tail costs only its own texels. gl_FragCoord.xy is still the texel of the output.
+    /// 3. inputs are bound to the units 0, 1, ..., the output is pinned to color0.
+    /// 4. build the fragment shader with build(), or use vertexSource() for your own program.
+    struct GpuLauncher
+    {
+        GpuFBODevice<> dev_;
+        GLuint vao_ = 0;
+        
+        ~GpuLauncher()
+        {
+            if (vao_)
+                glDeleteVertexArrays(1, &vao_);
+            vao_ = 0;
+        }
+        static const char* vertexSource()
+        {
+            return "#version 330 core\n"
+                "void main() {\n"
+                "    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+                "    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);\n"
+                "}\n";
+        }
+        static bool build(GpuProgram& program, const char* fragmentSource)
+        {
+            return program.build(vertexSource(), fragmentSource);
+        }
+        template<typename _Out, typename... _Img>
+        void launch(GpuProgram& program, _Out& output, GLsizei width, GLsizei height, _Img&... inputs)
+        {
+            launch(program, output, 0, 0, width, height, inputs...);
+        }
+        template<typename _Out, typename... _Img>
+        void launch(GpuProgram& program, _Out& output, GLint x, GLint y, GLsizei width, GLsizei height, _Img&... inputs)
+        {
+            GLuint unit = 0;
+            int expand[] = {0, (inputs.ensure(unit++), 0)...};
+            (void)expand;
+            glActiveTexture(GL_TEXTURE0);
+            program.ensure();
+            dev_.ensure();
+            dev_.color0PinGpuImage(output);
+            GpuFBODevice<>::openDrawCurrentFBO(0);
+            draw(x, y, width, height);
+            dev_.color0PinTexture(0);
+            dev_.leave();
+            program.leave();
+        }
+        /// the program, the inputs and the FBO are bound by the caller
+        void draw(GLint x, GLint y, GLsizei width, GLsizei height)
+        {
+            GpuViewportSaver saver;
+            glViewport(x, y, width, height);
+            glEnable(GL_SCISSOR_TEST);
+            glScissor(x, y, width, height);
+            if (!vao_)
+                glGenVertexArrays(1, &vao_);
+            glBindVertexArray(vao_);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            glBindVertexArray(0);
+        }
+    };
+    
+    /// Z#20261019
+    ///  sparse data, most tiles of the output have nothing to do, but the kernel runs on every texel.
+    ///  the mask is built on the gpu, inactive tiles are skipped by conditional rendering, no readback.
+    /// 1. probe(), one occlusion query (GL_ANY_SAMPLES_PASSED, GL3.3) per tile, around a draw of the tile
+    ///    by the probe program, which discards the inactive texels. the color writes are masked off.
+    /// 2. the probe is `bool texelActive(ivec2 p)` of GLSL reading uIn0, the default is any of r, g, b not 0,
+    ///    alpha is 1 for GL_RED and GL_RG images.
+    ///    `active` is a reserved word of GLSL.
+    ///    it is one fetch and a discard, the kernel may be much heavier.
+    /// 3. launch(), the kernel is drawn tile by tile, each inside glBeginConditionalRender of its query.
+    ///    GL_QUERY_WAIT, the gpu waits the query, the cpu does not.
+    /// 4. the texels of inactive tiles are not written, clear the output first if needed.
+    /// 5. activeTiles() reads the queries back, for statistics only, it blocks.
+    struct GpuTileMask
+    {
+        GLsizei width_ = 0;
+        GLsizei height_ = 0;
+        GLsizei tile_ = 0;
+        GLsizei cols_ = 0;
+        GLsizei rows_ = 0;
+        std::vector<GLuint> queries_;
+        GpuProgram probe_;
+        GpuLauncher launcher_;
+        
+        ~GpuTileMask()
+        {
+            if (!queries_.empty())
+                glDeleteQueries((GLsizei)queries_.size(), queries_.data());
+            queries_.clear();
+        }
+        bool build(const char* activeSource = 0)
+        {
+            std::string fs = "#version 330 core\nuniform sampler2D uIn0;\nout vec4 fragColor;\n";
+            fs.append(activeSource ? activeSource :
+                "bool texelActive(ivec2 p) {\n"
+                "    return any(notEqual(texelFetch(uIn0, p, 0).rgb, vec3(0.0)));\n"
+                "}\n");
+            fs.append("\nvoid main() {\n"
+                "    if (!texelActive(ivec2(gl_FragCoord.xy)))\n"
+                "        discard;\n"
+                "    fragColor = vec4(0.0);\n"
+                "}\n");
+            if (!GpuLauncher::build(probe_, fs.c_str()))
+                return false;
+            probe_.ensure();
+            probe_.setUniform1i("uIn0", 0);
+            probe_.leave();
+            return true;
+        }
+        void resize(GLsizei width, GLsizei height, GLsizei tile)
+        {
+            if (!queries_.empty())
+                glDeleteQueries((GLsizei)queries_.size(), queries_.data());
+            width_ = width;
+            height_ = height;
+            tile_ = tile;
+            cols_ = (width + tile - 1) / tile;
+            rows_ = (height + tile - 1) / tile;
+            queries_.assign((size_t)cols_ * rows_, 0);
+            glGenQueries((GLsizei)queries_.size(), queries_.data());
+        }
+        /// the output is only the render target of the probe, nothing is written to it
+        template<typename _Out, typename _Img>
+        void probe(_Out& output, _Img& input)
+        {
+            input.ensure(0);
+            probe_.ensure();
+            launcher_.dev_.ensure();
+            launcher_.dev_.color0PinGpuImage(output);
+            GpuFBODevice<>::openDrawCurrentFBO(0);
+            GLboolean mask[4];
+            glGetBooleanv(GL_COLOR_WRITEMASK, mask);
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            for (GLsizei t = 0; t < (GLsizei)queries_.size(); ++t)
+            {
+                glBeginQuery(GL_ANY_SAMPLES_PASSED, queries_[t]);
+                drawTile(t);
+                glEndQuery(GL_ANY_SAMPLES_PASSED);
+            }
+            glColorMask(mask[0], mask[1], mask[2], mask[3]);
+            launcher_.dev_.color0PinTexture(0);
+            launcher_.dev_.leave();
+            probe_.leave();
+        }
+        /// inputs are bound to the units 0, 1, ..., like GpuLauncher::launch
+        template<typename _Out, typename... _Img>
+        void launch(GpuProgram& program, _Out& output, _Img&... inputs)
+        {
+            GLuint unit = 0;
+            int expand[] = {0, (inputs.ensure(unit++), 0)...};
+            (void)expand;
+            glActiveTexture(GL_TEXTURE0);
+            program.ensure();
+            launcher_.dev_.ensure();
+            launcher_.dev_.color0PinGpuImage(output);
+            GpuFBODevice<>::openDrawCurrentFBO(0);
+            for (GLsizei t = 0; t < (GLsizei)queries_.size(); ++t)
+            {
+                glBeginConditionalRender(queries_[t], GL_QUERY_WAIT);
+                drawTile(t);
+                glEndConditionalRender();
+            }
+            launcher_.dev_.color0PinTexture(0);
+            launcher_.dev_.leave();
+            program.leave();
+        }
+        GLsizei activeTiles()
+        {
+            GLsizei n = 0;
+            for (size_t t = 0; t < queries_.size(); ++t)
+            {
+                GLuint any = 0;
+                glGetQueryObjectuiv(queries_[t], GL_QUERY_RESULT, &any);
+                n += any ? 1 : 0;
+            }
+            return n;
+        }
+        GLsizei tiles() const
+        {
+            return (GLsizei)queries_.size();
+        }
+    private:
+        void drawTile(GLsizei t)
+        {
+            GLint x = (t % cols_) * tile_;
+            GLint y = (t / cols_) * tile_;
+            launcher_.draw(x, y, std::min(tile_, width_ - x), std::min(tile_, height_ - y));
+        }
+    };
+    
+    /// Z#20261019
+    ///  one draw for all slices of a layered attachment, instance i draws to slice i.
+    /// 1. gl_Layer in the vertex shader, GL_ARB_shader_viewport_layer_array or GL_AMD_vertex_shader_layer.
+    /// 2. otherwise a pass-through geometry shader writes gl_Layer.
+    /// 3. the fragment shader gets `flat in int vLayer;` to sample the same slice of the input array.
+    ///     texelFetch(uIn, ivec3(gl_FragCoord.xy, vLayer), 0)
+    /// 4. instance i draws to slice uFirstLayer + i, the base instance of a draw does not offset gl_InstanceID.
+    struct GpuLayeredPass
+    {
+        GpuProgram program_;
+        GLuint vao_ = 0;
+        
+        ~GpuLayeredPass()
+        {
+            if (vao_)
+                glDeleteVertexArrays(1, &vao_);
+        }
+        static const char* vertexExtension()
+        {
+            if (GpuExtensions::has("GL_ARB_shader_viewport_layer_array"))
+                return "GL_ARB_shader_viewport_layer_array";
+            if (GpuExtensions::has("GL_AMD_vertex_shader_layer"))
+                return "GL_AMD_vertex_shader_layer";
+            return 0;
+        }
+        /// fragmentSource is the whole shader, with `#version 330 core` or later
+        bool build(const char* fragmentSource)
+        {
+            const char* ext = vertexExtension();
+            if (ext)
+            {
+                std::string vs = "#version 330 core\n#extension ";
+                vs.append(ext).append(" : require\n"
+                    "uniform int uFirstLayer;\n"
+                    "flat out int vLayer;\n"
+                    "void main() {\n"
+                    "    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+                    "    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);\n"
+                    "    gl_Layer = uFirstLayer + gl_InstanceID;\n"
+                    "    vLayer = uFirstLayer + gl_InstanceID;\n"
+                    "}\n");
+                if (!program_.build(vs.c_str(), fragmentSource))
+                    return false;
+            }
+            else
+            {
+                static const char* vs =
+                    "#version 330 core\n"
+                    "uniform int uFirstLayer;\n"
+                    "flat out int vInstance;\n"
+                    "void main() {\n"
+                    "    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+                    "    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);\n"
+                    "    vInstance = uFirstLayer + gl_InstanceID;\n"
+                    "}\n";
+                static const char* gs =
+                    "#version 330 core\n"
+                    "layout(triangles) in;\n"
+                    "layout(triangle_strip, max_vertices = 3) out;\n"
+                    "flat in int vInstance[];\n"
+                    "flat out int vLayer;\n"
+                    "void main() {\n"
+                    "    for (int i = 0; i < 3; ++i) {\n"
+                    "        gl_Position = gl_in[i].gl_Position;\n"
+                    "        gl_Layer = vInstance[0];\n"
+                    "        vLayer = vInstance[0];\n"
+                    "        EmitVertex();\n"
+                    "    }\n"
+                    "    EndPrimitive();\n"
+                    "}\n";
+                if (!program_.build(vs, gs, fragmentSource))
+                    return false;
+            }
+            if (!vao_)
+                glGenVertexArrays(1, &vao_);
+            return true;
+        }
+        /// the program is ensured, the layered attachment is pinned to the current FBO.
+        void draw(GLint firstLayer, GLsizei layers)
+        {
+            program_.setUniform1i("uFirstLayer", firstLayer);
+            glBindVertexArray(vao_);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 3, layers);
+            glBindVertexArray(0);
+        }
+        void draw(GLsizei layers)
+        {
+            draw(0, layers);
+        }
+    };
 }; // NS GL3
 }; // NS zhelper
 
@@ -0,0 +1,444 @@
+/**
+MIT License
+
+Copyright (c) 2022-2024 bbqz007 <https://github.com/bbqz007, http://www.cnblogs.com/bbqzsl>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __ZHELPER_GRAPH_H_
+#define __ZHELPER_GRAPH_H_
+
+#include "zgl_helper.h"
+#include <initializer_list>
+#include <map>
+#include <memory>
+
+/// Z#20261019 Design
+///  VAO is the datasource, FBO is the datasink, and Shaders are the Filters.
+///  the graph composes the filters, like the filter graph of DirectShow.
+///
+/// 1. nodes
+/// 1.a source(), a GpuImage2D of the user, or one uploaded by upload().
+/// 1.b kernel(), a GLSL `vec4 kernel(ivec2 p)` reading its inputs by uIn0, uIn1, ... at any texel.
+/// 1.c map(), elementwise, a GLSL expression of x0, x1, ... (vec4), the inputs at the same texel.
+/// 1.d output() marks the nodes whose images are kept after run().
+/// 2. compile()
+/// 2.a topological order, false for a cycle.
+/// 2.b fusion, a map or a kernel with one consumer, which is a map of the same size, is inlined
+///     into the pass of the consumer. one kernel per pass at most, it is the first of the pass.
+///     so `kernel -> map -> map` is one pass, the intermediate images are never written.
+/// 2.c passes are scheduled in the order of their last node.
+/// 2.d lifetime, an intermediate image returns to the pool after the last pass reading it,
+///     the next pass of the same size reuses it. the output of a pass is acquired before
+///     its inputs are released, so a pass never samples the image it draws to.
+/// 2.e programs are cached by the generated source.
+/// 3. run()
+/// 3.a no host round trip between passes.
+/// 3.b FBO write then texture fetch in a later pass is ordered by gl, no barrier is needed.
+/// 3.c a fence is made after the last pass, read() waits for it, or wait() by yourself.
+///
+/// LIMIT:
+/// 1. GL_TEXTURE_2D only, every image of the graph is _Fmt.
+
+namespace zhelper
+{
+namespace GL3
+{
+    template<typename _Fmt = GpuFormatR32F>
+    struct GpuKernelGraph
+    {
+        enum { MAX_SAMPLERS = 16 };
+        enum NodeKind
+        {
+            NODE_SOURCE = 0,
+            NODE_KERNEL,
+            NODE_MAP,
+        };
+        struct Node
+        {
+            NodeKind kind_;
+            std::string glsl_;
+            std::vector<int> inputs_;
+            GLsizei width_;
+            GLsizei height_;
+            GpuImage2D* external_;
+            bool output_;
+        };
+        struct Pass
+        {
+            std::vector<int> members_;      /// topological order, the last is the root
+            std::vector<int> samplers_;     /// node of uIn<i>
+            GpuProgram* program_;
+        };
+
+        std::vector<Node> nodes_;
+        std::vector<Pass> passes_;
+        std::vector<std::unique_ptr<GpuImage2D> > images_;
+        std::vector<std::pair<GLsizei, GLsizei> > sizes_;
+        std::vector<int> image_;            /// node -> images_, -1 when fused or external
+        std::map<std::string, std::unique_ptr<GpuProgram> > programs_;
+        GpuLauncher launcher_;
+        GLsync sync_ = 0;
+        std::string log_;
+
+        ~GpuKernelGraph()
+        {
+            if (sync_)
+                glDeleteSync(sync_);
+            sync_ = 0;
+        }
+        int source(GLsizei width, GLsizei height)
+        {
+            return add(NODE_SOURCE, std::string(), {}, width, height, 0);
+        }
+        int source(GpuImage2D& image, GLsizei width, GLsizei height)
+        {
+            return add(NODE_SOURCE, std::string(), {}, width, height, &image);
+        }
+        /// width and height 0, the size of the first input
+        int kernel(const std::string& glsl, std::initializer_list<int> inputs, GLsizei width = 0, GLsizei height = 0)
+        {
+            return add(NODE_KERNEL, glsl, inputs, width, height, 0);
+        }
+        int map(const std::string& expr, std::initializer_list<int> inputs)
+        {
+            return add(NODE_MAP, expr, inputs, 0, 0, 0);
+        }
+        void output(int node)
+        {
+            nodes_[node].output_ = true;
+        }
+        bool compile()
+        {
+            passes_.clear();
+            images_.clear();
+            sizes_.clear();
+            log_.clear();
+            std::vector<int> order;
+            if (!sort(order))
+            {
+                log_ = "cycle";
+                return false;
+            }
+            std::vector<int> consumers(nodes_.size(), 0);
+            for (size_t n = 0; n < nodes_.size(); ++n)
+                for (size_t i = 0; i < nodes_[n].inputs_.size(); ++i)
+                    ++consumers[nodes_[n].inputs_[i]];
+
+            /// consumers before producers, a node joins the pass of its only consumer
+            std::vector<int> pass(nodes_.size(), -1);
+            std::vector<bool> hasKernel;
+            for (size_t k = order.size(); k-- > 0;)
+            {
+                int n = order[k];
+                const Node& node = nodes_[n];
+                if (node.kind_ == NODE_SOURCE)
+                    continue;
+                int c = (consumers[n] == 1 && !node.output_) ? consumerOf(n) : -1;
+                if (c >= 0 && nodes_[c].kind_ == NODE_MAP && pass[c] >= 0
+                    && node.width_ == nodes_[c].width_ && node.height_ == nodes_[c].height_
+                    && (node.kind_ == NODE_MAP || !hasKernel[pass[c]]))
+                {
+                    pass[n] = pass[c];
+                    if (node.kind_ == NODE_KERNEL)
+                        hasKernel[pass[n]] = true;
+                    continue;
+                }
+                pass[n] = (int)passes_.size();
+                passes_.push_back(Pass());
+                hasKernel.push_back(node.kind_ == NODE_KERNEL);
+            }
+            for (size_t k = 0; k < order.size(); ++k)
+                if (pass[order[k]] >= 0)
+                    passes_[pass[order[k]]].members_.push_back(order[k]);
+            /// the root is the last member, so the order of the roots is a topological order of the passes
+            std::vector<int> position(nodes_.size(), 0);
+            for (size_t k = 0; k < order.size(); ++k)
+                position[order[k]] = (int)k;
+            std::sort(passes_.begin(), passes_.end(), [&position](const Pass& a, const Pass& b) {
+                return position[a.members_.back()] < position[b.members_.back()];
+            });
+            for (size_t p = 0; p < passes_.size(); ++p)
+                for (size_t m = 0; m < passes_[p].members_.size(); ++m)
+                    pass[passes_[p].members_[m]] = (int)p;
+
+            for (size_t p = 0; p < passes_.size(); ++p)
+            {
+                collectSamplers(passes_[p], pass, (int)p);
+                if (!(passes_[p].program_ = program(generate(passes_[p], pass, (int)p))))
+                    return false;
+            }
+            allocate();
+            return true;
+        }
+        /// the graph image of a source, the context should be current
+        void upload(int node, const float* data)
+        {
+            GpuImage2D* image = imageOf(node);
+            image->ensure();
+            image->template copyFromFloatMemory<_Fmt>(0, 0, nodes_[node].width_, nodes_[node].height_, data);
+        }
+        void run()
+        {
+            if (sync_)
+                glDeleteSync(sync_);
+            launcher_.dev_.ensure();
+            GpuFBODevice<>::openDrawCurrentFBO(0);
+            for (size_t p = 0; p < passes_.size(); ++p)
+            {
+                const Pass& pass = passes_[p];
+                const Node& root = nodes_[pass.members_.back()];
+                launcher_.dev_.color0PinGpuImage2D(*imageOf(pass.members_.back()));
+                for (size_t i = 0; i < pass.samplers_.size(); ++i)
+                    imageOf(pass.samplers_[i])->ensure((GLuint)i);
+                pass.program_->ensure();
+                launcher_.draw(0, 0, root.width_, root.height_);
+            }
+            glActiveTexture(GL_TEXTURE0);
+            if (!passes_.empty())
+                passes_.back().program_->leave();
+            launcher_.dev_.color0PinTexture(0);
+            launcher_.dev_.leave();
+            sync_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+        bool wait(GLuint64 timeout = GL_TIMEOUT_IGNORED)
+        {
+            if (!sync_)
+                return true;
+            GLenum r = glClientWaitSync(sync_, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+            if (r == GL_TIMEOUT_EXPIRED)
+                return false;
+            glDeleteSync(sync_);
+            sync_ = 0;
+            return r != GL_WAIT_FAILED;
+        }
+        /// an output or a source
+        void read(int node, float* data)
+        {
+            wait();
+            GpuImage2D* image = imageOf(node);
+            image->ensure();
+            image->template copyToFloatMemory<_Fmt>(data);
+        }
+        GpuImage2D* imageOf(int node)
+        {
+            if (nodes_[node].external_)
+                return nodes_[node].external_;
+            return (image_[node] >= 0) ? images_[image_[node]].get() : 0;
+        }
+        size_t passes() const
+        {
+            return passes_.size();
+        }
+        /// the images the graph owns, after aliasing
+        size_t images() const
+        {
+            return images_.size();
+        }
+    private:
+        int add(NodeKind kind, const std::string& glsl, std::initializer_list<int> inputs,
+                GLsizei width, GLsizei height, GpuImage2D* external)
+        {
+            Node node;
+            node.kind_ = kind;
+            node.glsl_ = glsl;
+            node.inputs_.assign(inputs.begin(), inputs.end());
+            node.width_ = (!width && !node.inputs_.empty()) ? nodes_[node.inputs_[0]].width_ : width;
+            node.height_ = (!height && !node.inputs_.empty()) ? nodes_[node.inputs_[0]].height_ : height;
+            node.external_ = external;
+            node.output_ = false;
+            nodes_.push_back(node);
+            return (int)nodes_.size() - 1;
+        }
+        /// Kahn
+        bool sort(std::vector<int>& order)
+        {
+            std::vector<int> degree(nodes_.size(), 0);
+            for (size_t n = 0; n < nodes_.size(); ++n)
+                degree[n] = (int)nodes_[n].inputs_.size();
+            for (size_t n = 0; n < nodes_.size(); ++n)
+                if (!degree[n])
+                    order.push_back((int)n);
+            for (size_t k = 0; k < order.size(); ++k)
+                for (size_t n = 0; n < nodes_.size(); ++n)
+                    for (size_t i = 0; i < nodes_[n].inputs_.size(); ++i)
+                        if (nodes_[n].inputs_[i] == order[k] && !--degree[n])
+                            order.push_back((int)n);
+            return order.size() == nodes_.size();
+        }
+        int consumerOf(int node)
+        {
+            for (size_t n = 0; n < nodes_.size(); ++n)
+                for (size_t i = 0; i < nodes_[n].inputs_.size(); ++i)
+                    if (nodes_[n].inputs_[i] == node)
+                        return (int)n;
+            return -1;
+        }
+        /// the inputs of the kernel first, in its order, then the other images read by the maps
+        void collectSamplers(Pass& pass, const std::vector<int>& owner, int p)
+        {
+            for (size_t m = 0; m < pass.members_.size(); ++m)
+            {
+                const Node& node = nodes_[pass.members_[m]];
+                if (node.kind_ == NODE_KERNEL)
+                    pass.samplers_ = node.inputs_;
+            }
+            for (size_t m = 0; m < pass.members_.size(); ++m)
+            {
+                const Node& node = nodes_[pass.members_[m]];
+                if (node.kind_ != NODE_MAP)
+                    continue;
+                for (size_t i = 0; i < node.inputs_.size(); ++i)
+                {
+                    int in = node.inputs_[i];
+                    if (owner[in] != p && std::find(pass.samplers_.begin(), pass.samplers_.end(), in) == pass.samplers_.end())
+                        pass.samplers_.push_back(in);
+                }
+            }
+        }
+        /// locals are named by the position in the pass, so the same chain elsewhere shares the program
+        std::string generate(const Pass& pass, const std::vector<int>& owner, int p)
+        {
+            std::string fs = "#version 330 core\n";
+            for (size_t i = 0; i < pass.samplers_.size(); ++i)
+                fs.append("uniform ").append(GpuImage2D::glslType()).append(" uIn").append(std::to_string(i)).append(";\n");
+            fs.append("out vec4 fragColor;\n");
+            for (size_t m = 0; m < pass.members_.size(); ++m)
+            {
+                const Node& node = nodes_[pass.members_[m]];
+                if (node.kind_ == NODE_KERNEL)
+                {
+                    fs.append(node.glsl_).append("\n");
+                    continue;
+                }
+                fs.append("vec4 f").append(std::to_string(m)).append("(");
+                for (size_t i = 0; i < node.inputs_.size(); ++i)
+                    fs.append(i ? ", " : "").append("vec4 x").append(std::to_string(i));
+                fs.append(") {\n    return ").append(node.glsl_).append(";\n}\n");
+            }
+            fs.append("void main() {\n    ivec2 p = ivec2(gl_FragCoord.xy);\n");
+            for (size_t m = 0; m < pass.members_.size(); ++m)
+            {
+                const Node& node = nodes_[pass.members_[m]];
+                fs.append("    vec4 v").append(std::to_string(m)).append(" = ");
+                if (node.kind_ == NODE_KERNEL)
+                {
+                    fs.append("kernel(p);\n");
+                    continue;
+                }
+                fs.append("f").append(std::to_string(m)).append("(");
+                for (size_t i = 0; i < node.inputs_.size(); ++i)
+                {
+                    int in = node.inputs_[i];
+                    fs.append(i ? ", " : "");
+                    if (owner[in] == p)
+                    {
+                        size_t v = std::find(pass.members_.begin(), pass.members_.end(), in) - pass.members_.begin();
+                        fs.append("v").append(std::to_string(v));
+                    }
+                    else
+                    {
+                        size_t s = std::find(pass.samplers_.begin(), pass.samplers_.end(), in) - pass.samplers_.begin();
+                        fs.append("texelFetch(uIn").append(std::to_string(s)).append(", p, 0)");
+                    }
+                }
+                fs.append(");\n");
+            }
+            fs.append("    fragColor = v").append(std::to_string(pass.members_.size() - 1)).append(";\n}\n");
+            return fs;
+        }
+        GpuProgram* program(const std::string& fs)
+        {
+            std::unique_ptr<GpuProgram>& cached = programs_[fs];
+            if (cached)
+                return cached.get();
+            std::unique_ptr<GpuProgram> program(new GpuProgram);
+            if (!GpuLauncher::build(*program, fs.c_str()))
+            {
+                log_ = program->log_;
+                programs_.erase(fs);
+                return 0;
+            }
+            /// uIn<i> is the unit i, for ever
+            program->ensure();
+            for (GLint i = 0; i < MAX_SAMPLERS; ++i)
+            {
+                GLint loc = program->uniform(("uIn" + std::to_string(i)).c_str());
+                if (loc >= 0)
+                    glUniform1i(loc, i);
+            }
+            program->leave();
+            cached = std::move(program);
+            return cached.get();
+        }
+        /// sources and outputs own their images, intermediates share the pool by size
+        void allocate()
+        {
+            image_.assign(nodes_.size(), -1);
+            std::vector<int> uses(nodes_.size(), 0);
+            for (size_t p = 0; p < passes_.size(); ++p)
+                for (size_t i = 0; i < passes_[p].samplers_.size(); ++i)
+                    ++uses[passes_[p].samplers_[i]];
+            std::vector<int> free;
+            for (size_t n = 0; n < nodes_.size(); ++n)
+                if (nodes_[n].kind_ == NODE_SOURCE && !nodes_[n].external_)
+                    image_[n] = create(nodes_[n]);
+            for (size_t p = 0; p < passes_.size(); ++p)
+            {
+                int root = passes_[p].members_.back();
+                const Node& node = nodes_[root];
+                if (node.output_)
+                    image_[root] = create(node);
+                else
+                {
+                    std::vector<int>::iterator it = std::find_if(free.begin(), free.end(), [this, &node](int i) {
+                        return sizes_[i].first == node.width_ && sizes_[i].second == node.height_;
+                    });
+                    if (it != free.end())
+                    {
+                        image_[root] = *it;
+                        free.erase(it);
+                    }
+                    else
+                        image_[root] = create(node);
+                }
+                for (size_t i = 0; i < passes_[p].samplers_.size(); ++i)
+                {
+                    int in = passes_[p].samplers_[i];
+                    if (!--uses[in] && nodes_[in].kind_ != NODE_SOURCE && !nodes_[in].output_)
+                        free.push_back(image_[in]);
+                }
+            }
+        }
+        int create(const Node& node)
+        {
+            std::unique_ptr<GpuImage2D> image(new GpuImage2D);
+            image->ensure();
+            image->setGP();
+            image->template allocFormat<_Fmt>(node.width_, node.height_);
+            images_.push_back(std::move(image));
+            sizes_.push_back(std::make_pair(node.width_, node.height_));
+            return (int)images_.size() - 1;
+        }
+    };
+}; // NS GL3
+}; // NS zhelper
+
+#endif // __ZHELPER_GRAPH_H_
@@ -0,0 +1,360 @@
+/**
+MIT License
+
+Copyright (c) 2022-2024 bbqz007 <https://github.com/bbqz007, http://www.cnblogs.com/bbqzsl>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __ZHELPER_SCHED_H_
+#define __ZHELPER_SCHED_H_
+
+#include "zegl_helper.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+/// Z#20261019 Design
+///  every zhelper wrapper uses the context current on the calling thread.
+///  the scheduler owns the contexts and the threads, cpu threads never touch gl.
+///
+/// 1. a GpuWorker is a thread with its own context, all contexts are in one share group.
+/// 2. jobs are callables, they run on the worker thread with the context current.
+/// 2.a submit from any thread, the queue is lock free (multi producers, single consumer).
+/// 2.b a job returns R, the submitter gets std::future<R>. exceptions go to the future too.
+/// 2.c before start() or after stop(), the future holds std::runtime_error, the job never runs.
+/// 3. GpuScheduler has two lanes.
+/// 3.a upload lane, one worker, uploads are in order. GpuBufferImage::copyFromCpuMemory, etc.
+/// 3.b compute lane, N workers, round robin. GpuFBODevice, shaders, readbacks.
+/// 4. sharing between contexts
+/// 4.a after every upload job, a fence is made and flushed, BEFORE its future is ready.
+/// 4.b every compute job glWaitSync the last fence first.
+/// 4.c so a compute job sees every upload whose future has been ready.
+/// 4.d FBOs and VAOs are not shared, make them in the compute job, or keep them per worker.
+
+namespace zhelper
+{
+namespace EGL
+{
+    /// Dmitry Vyukov's intrusive MPSC queue.
+    ///  push is wait free, pop is for the single consumer.
+    template<typename _Ty>
+    struct GpuJobQueue
+    {
+        struct Node
+        {
+            std::atomic<Node*> next_;
+            _Ty value_;
+        };
+        std::atomic<Node*> head_;
+        Node* tail_;
+        Node stub_;
+
+        GpuJobQueue()
+        {
+            stub_.next_.store(0, std::memory_order_relaxed);
+            head_.store(&stub_, std::memory_order_relaxed);
+            tail_ = &stub_;
+        }
+        ~GpuJobQueue()
+        {
+            while (Node* n = pop())
+                delete n;
+        }
+        void push(Node* n)
+        {
+            n->next_.store(0, std::memory_order_relaxed);
+            Node* prev = head_.exchange(n, std::memory_order_acq_rel);
+            prev->next_.store(n, std::memory_order_release);
+        }
+        /// 0 when empty, or a producer is between exchange and store, try again later.
+        Node* pop()
+        {
+            Node* tail = tail_;
+            Node* next = tail->next_.load(std::memory_order_acquire);
+            if (tail == &stub_)
+            {
+                if (!next)
+                    return 0;
+                tail_ = next;
+                tail = next;
+                next = next->next_.load(std::memory_order_acquire);
+            }
+            if (next)
+            {
+                tail_ = next;
+                return tail;
+            }
+            if (tail != head_.load(std::memory_order_acquire))
+                return 0;
+            push(&stub_);
+            next = tail->next_.load(std::memory_order_acquire);
+            if (next)
+            {
+                tail_ = next;
+                return tail;
+            }
+            return 0;
+        }
+    };
+
+    /// a fence shared between contexts of the share group
+    struct GpuSharedFence
+    {
+        GLsync sync_ = 0;
+        ~GpuSharedFence()
+        {
+            /// any context of the share group is current on the worker threads
+            if (sync_)
+                glDeleteSync(sync_);
+        }
+    };
+
+    struct GpuWorker
+    {
+        typedef GpuJobQueue<std::function<void()> > Queue;
+
+        GpuContext ctx_;
+        Queue queue_;
+        std::atomic<int> pending_;
+        std::atomic<bool> sleeping_;
+        std::atomic<bool> stop_;
+        std::mutex mtx_;
+        std::condition_variable cv_;
+        std::thread thread_;
+        std::function<void()> prologue_;  /// runs on the worker before every job
+
+        GpuWorker() : pending_(0), sleeping_(false), stop_(false)
+        {
+        }
+        ~GpuWorker()
+        {
+            stop();
+        }
+        /// the context is created here, but made current on the worker thread.
+        bool start(const GpuContext& root)
+        {
+            if (!ctx_.createShared(root))
+                return false;
+            std::promise<bool> ready;
+            std::future<bool> current = ready.get_future();
+            thread_ = std::thread([this, &ready]() {
+                ready.set_value(ctx_.makeCurrent());
+                run();
+                ctx_.release();
+            });
+            if (!current.get())
+            {
+                stop();
+                return false;
+            }
+            return true;
+        }
+        void stop()
+        {
+            if (!thread_.joinable())
+                return;
+            {
+                std::lock_guard<std::mutex> lk(mtx_);
+                stop_ = true;
+            }
+            cv_.notify_one();
+            thread_.join();
+        }
+        bool running() const
+        {
+            return thread_.joinable();
+        }
+        template<typename _Fn>
+        auto submit(_Fn fn) -> std::future<decltype(fn())>
+        {
+            typedef decltype(fn()) R;
+            std::shared_ptr<std::packaged_task<R()> > task = std::make_shared<std::packaged_task<R()> >(std::move(fn));
+            std::future<R> result = task->get_future();
+            post([task]() { (*task)(); });
+            return result;
+        }
+        void post(std::function<void()> job)
+        {
+            typename Queue::Node* n = new typename Queue::Node;
+            n->value_ = std::move(job);
+            /// pending_ first, so the worker spins rather than sleeps while the node is in flight
+            pending_.fetch_add(1);
+            queue_.push(n);
+            if (sleeping_.load())
+            {
+                std::lock_guard<std::mutex> lk(mtx_);
+                cv_.notify_one();
+            }
+        }
+    private:
+        void run()
+        {
+            for (;;)
+            {
+                if (typename Queue::Node* n = queue_.pop())
+                {
+                    if (prologue_)
+                        prologue_();
+                    n->value_();
+                    delete n;
+                    pending_.fetch_sub(1);
+                    continue;
+                }
+                if (pending_.load() > 0)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                std::unique_lock<std::mutex> lk(mtx_);
+                if (stop_)
+                    break;
+                sleeping_ = true;
+                cv_.wait(lk, [this]() { return pending_.load() > 0 || stop_; });
+                sleeping_ = false;
+            }
+        }
+    };
+
+    struct GpuScheduler
+    {
+        GpuContext root_;
+        GpuWorker upload_;
+        std::vector<std::unique_ptr<GpuWorker> > compute_;
+        std::atomic<unsigned> next_;
+        std::mutex fenceMtx_;
+        std::shared_ptr<GpuSharedFence> lastUpload_;
+
+        GpuScheduler() : next_(0)
+        {
+        }
+        ~GpuScheduler()
+        {
+            stop();
+        }
+        /// the root context is never current, it is the owner of the share group.
+        bool startGL(unsigned computeWorkers = 1, GLint major = 4, GLint minor = 5, bool core = true)
+        {
+            return root_.createGL(major, minor, core) && start(computeWorkers);
+        }
+        bool startGLES(unsigned computeWorkers = 1, GLint major = 3, GLint minor = 0)
+        {
+            return root_.createGLES(major, minor) && start(computeWorkers);
+        }
+        void stop()
+        {
+            upload_.stop();
+            for (size_t i = 0; i < compute_.size(); ++i)
+                compute_[i]->stop();
+            compute_.clear();
+            /// the last fence is deleted on no thread, forget it with the contexts.
+            if (lastUpload_)
+                lastUpload_->sync_ = 0;
+            lastUpload_.reset();
+        }
+        /// the future is ready after the upload is flushed to the gpu.
+        template<typename _Fn>
+        auto upload(_Fn fn) -> std::future<decltype(fn())>
+        {
+            if (!upload_.running())
+                return notStarted<decltype(fn())>();
+            return upload_.submit([this, fn]() mutable {
+                struct Publish
+                {
+                    GpuScheduler* self;
+                    ~Publish()
+                    {
+                        /// run even if fn throws, later jobs should not wait for nothing
+                        std::shared_ptr<GpuSharedFence> fence = std::make_shared<GpuSharedFence>();
+                        fence->sync_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                        glFlush();
+                        std::lock_guard<std::mutex> lk(self->fenceMtx_);
+                        self->lastUpload_ = fence;
+                    }
+                } publish = {this};
+                return fn();
+            });
+        }
+        template<typename _Fn>
+        auto compute(_Fn fn) -> std::future<decltype(fn())>
+        {
+            /// Z#20261019 bug
+            ///  % compute_.size() divided by zero before start() or after stop().
+            if (compute_.empty())
+                return notStarted<decltype(fn())>();
+            unsigned i = next_.fetch_add(1) % compute_.size();
+            return compute_[i]->submit(std::move(fn));
+        }
+        template<typename _Fn>
+        auto compute(unsigned worker, _Fn fn) -> std::future<decltype(fn())>
+        {
+            if (compute_.empty())
+                return notStarted<decltype(fn())>();
+            return compute_[worker % compute_.size()]->submit(std::move(fn));
+        }
+        size_t computeWorkers() const
+        {
+            return compute_.size();
+        }
+    private:
+        template<typename R>
+        static std::future<R> notStarted()
+        {
+            std::promise<R> result;
+            result.set_exception(std::make_exception_ptr(std::runtime_error("GpuScheduler is not started")));
+            return result.get_future();
+        }
+        bool start(unsigned computeWorkers)
+        {
+            if (!upload_.start(root_))
+                return false;
+            if (!computeWorkers)
+                computeWorkers = 1;
+            for (unsigned i = 0; i < computeWorkers; ++i)
+            {
+                std::unique_ptr<GpuWorker> worker(new GpuWorker);
+                worker->prologue_ = [this]() { waitUploads(); };
+                if (!worker->start(root_))
+                    return false;
+                compute_.push_back(std::move(worker));
+            }
+            return true;
+        }
+        void waitUploads()
+        {
+            std::shared_ptr<GpuSharedFence> fence;
+            {
+                std::lock_guard<std::mutex> lk(fenceMtx_);
+                fence = lastUpload_;
+            }
+            /// the gpu waits, the worker thread does not
+            if (fence && fence->sync_)
+                glWaitSync(fence->sync_, 0, GL_TIMEOUT_IGNORED);
+        }
+    };
+}; // NS EGL
+}; // NS zhelper
+
+#endif // __ZHELPER_SCHED_H_
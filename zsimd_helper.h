@@ -0,0 +1,258 @@
+/**
+MIT License
+
+Copyright (c) 2022-2024 bbqz007 <https://github.com/bbqz007, http://www.cnblogs.com/bbqzsl>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __ZHELPER_SIMD_H_
+#define __ZHELPER_SIMD_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#if defined(__F16C__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/// Z#20261019 Design
+///  host side conversion kernels, between the cpu memory (float []) and the texel layouts of gpu memory.
+///  this header does not include any gl header, zgl_helper.h and zes_helper.h both can use it.
+///
+/// 1. a half texel (GL_HALF_FLOAT) is 2 bytes, a unorm8 texel (GL_UNSIGNED_BYTE) is 1 byte,
+///    so the transfer bytes are 1/2 or 1/4 of GL_FLOAT.
+/// 2. SIMD paths are selected at compile time.
+/// 2.a -mf16c, F16C for float <-> half, 8 lanes.
+/// 2.b -mavx2, AVX2 for float <-> unorm8/unorm16, 8 lanes.
+/// 2.c otherwise the scalar paths, they give the same bits as the SIMD paths.
+///
+/// precision bounds, all round to nearest even.
+/// 1. half, |x| in [2^-14, 65504], relative error <= 2^-11.
+/// 1.a |x| < 2^-14 (subnormal), absolute error <= 2^-25.
+/// 1.b |x| > 65504 goes to inf, NaN keeps NaN.
+/// 2. unorm8, x clamped to [0, 1], absolute error <= 1/510.
+/// 3. unorm16, x clamped to [0, 1], absolute error <= 1/131070.
+
+namespace zhelper
+{
+namespace simd
+{
+    inline uint32_t _floatBits(float f)
+    {
+        uint32_t u;
+        memcpy(&u, &f, sizeof(u));
+        return u;
+    }
+    inline float _bitsFloat(uint32_t u)
+    {
+        float f;
+        memcpy(&f, &u, sizeof(f));
+        return f;
+    }
+
+    /// IEEE 754 binary32 -> binary16, round to nearest even.
+    inline uint16_t floatToHalf(float f)
+    {
+        uint32_t x = _floatBits(f);
+        uint32_t sign = (x >> 16) & 0x8000;
+        uint32_t absx = x & 0x7fffffff;
+        if (absx >= 0x7f800000)
+        {
+            /// inf or NaN, keep NaN quiet
+            return (uint16_t)(sign | 0x7c00 | ((absx > 0x7f800000) ? (0x200 | ((absx >> 13) & 0x3ff)) : 0));
+        }
+        if (absx >= 0x477ff000)
+        {
+            /// rounds to >= 65520, overflow to inf
+            return (uint16_t)(sign | 0x7c00);
+        }
+        if (absx < 0x38800000)
+        {
+            /// subnormal half, let the fpu do the rounding by adding 0.5f
+            float fa = _bitsFloat(absx) + 0.5f;
+            return (uint16_t)(sign | (_floatBits(fa) - 0x3f000000));
+        }
+        uint32_t mant_odd = (absx >> 13) & 1;
+        absx += 0xc8000fff + mant_odd;  /// rebias exponent (-112 << 23) and round
+        return (uint16_t)(sign | (absx >> 13));
+    }
+
+    /// IEEE 754 binary16 -> binary32, exact.
+    inline float halfToFloat(uint16_t h)
+    {
+        uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+        uint32_t expo = (h >> 10) & 0x1f;
+        uint32_t mant = h & 0x3ff;
+        if (expo == 0x1f)
+            return _bitsFloat(sign | 0x7f800000 | (mant << 13));
+        if (expo == 0)
+        {
+            /// zero or subnormal, mant * 2^-24
+            float f = (float)mant * (1.0f / 16777216.0f);
+            return _bitsFloat(sign | _floatBits(f));
+        }
+        return _bitsFloat(sign | ((expo + 112) << 23) | (mant << 13));
+    }
+
+    inline float _clamp01(float f)
+    {
+        /// NaN goes to 0
+        return (f > 0.f) ? ((f < 1.f) ? f : 1.f) : 0.f;
+    }
+    inline uint32_t _roundEven(float f)
+    {
+        /// f >= 0, same as cvtps_epi32 under the default MXCSR
+        uint32_t i = (uint32_t)f;
+        float r = f - (float)i;
+        if (r > 0.5f || (r == 0.5f && (i & 1)))
+            ++i;
+        return i;
+    }
+    inline uint8_t floatToUnorm8(float f)
+    {
+        return (uint8_t)_roundEven(_clamp01(f) * 255.f);
+    }
+    inline float unorm8ToFloat(uint8_t v)
+    {
+        return (float)v * (1.f / 255.f);
+    }
+    inline uint16_t floatToUnorm16(float f)
+    {
+        return (uint16_t)_roundEven(_clamp01(f) * 65535.f);
+    }
+    inline float unorm16ToFloat(uint16_t v)
+    {
+        return (float)v * (1.f / 65535.f);
+    }
+
+    /// batch kernels, n is the count of scalars, not texels.
+    /// src and dst should not overlap.
+    inline void floatToHalf(const float* src, uint16_t* dst, size_t n)
+    {
+        size_t i = 0;
+#ifdef __F16C__
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256 v = _mm256_loadu_ps(src + i);
+            _mm_storeu_si128((__m128i*)(dst + i), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+        }
+#endif
+        for (; i < n; ++i)
+            dst[i] = floatToHalf(src[i]);
+    }
+    inline void halfToFloat(const uint16_t* src, float* dst, size_t n)
+    {
+        size_t i = 0;
+#ifdef __F16C__
+        for (; i + 8 <= n; i += 8)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+            _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(v));
+        }
+#endif
+        for (; i < n; ++i)
+            dst[i] = halfToFloat(src[i]);
+    }
+    inline void floatToUnorm8(const float* src, uint8_t* dst, size_t n)
+    {
+        size_t i = 0;
+#ifdef __AVX2__
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.f);
+        const __m256 scale = _mm256_set1_ps(255.f);
+        for (; i + 8 <= n; i += 8)
+        {
+            /// max(v, 0) first, NaN goes to 0 like the scalar path
+            __m256 v = _mm256_max_ps(_mm256_loadu_ps(src + i), zero);
+            v = _mm256_mul_ps(_mm256_min_ps(v, one), scale);
+            __m256i i32 = _mm256_cvtps_epi32(v);
+            /// packus works inside 128 lanes, gather lane 0 and 2 back together
+            __m256i u16 = _mm256_permute4x64_epi64(_mm256_packus_epi32(i32, i32), 0x08);
+            __m128i u8 = _mm_packus_epi16(_mm256_castsi256_si128(u16), _mm256_castsi256_si128(u16));
+            _mm_storel_epi64((__m128i*)(dst + i), u8);
+        }
+#endif
+        for (; i < n; ++i)
+            dst[i] = floatToUnorm8(src[i]);
+    }
+    inline void unorm8ToFloat(const uint8_t* src, float* dst, size_t n)
+    {
+        size_t i = 0;
+#ifdef __AVX2__
+        const __m256 scale = _mm256_set1_ps(1.f / 255.f);
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256i i32 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + i)));
+            _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(i32), scale));
+        }
+#endif
+        for (; i < n; ++i)
+            dst[i] = unorm8ToFloat(src[i]);
+    }
+    inline void floatToUnorm16(const float* src, uint16_t* dst, size_t n)
+    {
+        size_t i = 0;
+#ifdef __AVX2__
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.f);
+        const __m256 scale = _mm256_set1_ps(65535.f);
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256 v = _mm256_max_ps(_mm256_loadu_ps(src + i), zero);
+            v = _mm256_mul_ps(_mm256_min_ps(v, one), scale);
+            __m256i i32 = _mm256_cvtps_epi32(v);
+            __m256i u16 = _mm256_permute4x64_epi64(_mm256_packus_epi32(i32, i32), 0x08);
+            _mm_storeu_si128((__m128i*)(dst + i), _mm256_castsi256_si128(u16));
+        }
+#endif
+        for (; i < n; ++i)
+            dst[i] = floatToUnorm16(src[i]);
+    }
+    inline void unorm16ToFloat(const uint16_t* src, float* dst, size_t n)
+    {
+        size_t i = 0;
+#ifdef __AVX2__
+        const __m256 scale = _mm256_set1_ps(1.f / 65535.f);
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256i i32 = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(src + i)));
+            _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(i32), scale));
+        }
+#endif
+        for (; i < n; ++i)
+            dst[i] = unorm16ToFloat(src[i]);
+    }
+
+    /// plain casts, for float and integer texels
+    template<typename _Dst, typename _Src>
+    inline void castCopy(const _Src* src, _Dst* dst, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = (_Dst)src[i];
+    }
+    template<>
+    inline void castCopy<float, float>(const float* src, float* dst, size_t n)
+    {
+        memcpy(dst, src, n * sizeof(float));
+    }
+}; // NS simd
+}; // NS zhelper
+
+#endif // __ZHELPER_SIMD_H_
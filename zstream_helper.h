@@ -0,0 +1,200 @@
+/**
+MIT License
+
+Copyright (c) 2022-2024 bbqz007 <https://github.com/bbqz007, http://www.cnblogs.com/bbqzsl>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __ZHELPER_STREAM_H_
+#define __ZHELPER_STREAM_H_
+
+#include "zgl_helper.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/// Z#20261019 Design
+///  a big binary file, read() to std::vector, then copyFromCpuMemory, that is two full copies,
+///  and the whole file is in the cpu memory.
+///  the stream mmap()s the file, and copies window by window into a ring of gpu buffers.
+///
+/// 1. the file -> the page cache -> the mapped gpu buffer, one copy, no std::vector.
+/// 2. windows are page aligned, the last one may be short.
+/// 3. the ring has _Depth buffers, window k uses buffer k % _Depth.
+/// 3.a before buffer b is written again, the fence after the kernel of window k - _Depth is waited.
+/// 4. madvise
+/// 4.a MADV_SEQUENTIAL for the whole map.
+/// 4.b MADV_WILLNEED for window k + 1 before window k is copied, the kernel readahead
+///     faults it in while the gpu runs the kernel of window k.
+/// 4.c MADV_DONTNEED for window k after it is copied, the pages leave the RSS.
+/// 4.d so the peak RSS is about two windows, whatever the file size is.
+/// 5. _Buffer is a GpuBuffer, GpuTexBuffer by default.
+/// 5.a GpuTexBuffer, attach it to GpuBufferImage by alloc(internalFormat, buf.vbo_) in the kernel.
+/// 5.b GL2::GpuPixelBufferDrawable, then GpuImage2D::copyFromGpuPixelBufferDrawable in the kernel.
+///
+/// LIMIT:
+/// 1. posix only.
+
+namespace zhelper
+{
+namespace GL3
+{
+    template<typename _Buffer = GpuTexBuffer, int _Depth = 2>
+    struct GpuFileStream
+    {
+        int fd_ = -1;
+        unsigned char* base_ = 0;
+        size_t size_ = 0;
+        size_t window_ = 0;
+        _Buffer ring_[_Depth];
+        GLsync fences_[_Depth] = {0};
+
+        ~GpuFileStream()
+        {
+            close();
+            for (int i = 0; i < _Depth; ++i)
+            {
+                if (fences_[i])
+                    glDeleteSync(fences_[i]);
+                fences_[i] = 0;
+            }
+        }
+        /// windowBytes is rounded up to pages
+        bool open(const char* path, size_t windowBytes)
+        {
+            close();
+            fd_ = ::open(path, O_RDONLY);
+            if (fd_ < 0)
+                return false;
+            struct stat st;
+            if (fstat(fd_, &st) != 0 || st.st_size <= 0)
+            {
+                close();
+                return false;
+            }
+            size_ = (size_t)st.st_size;
+            void* base = mmap(0, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+            if (base == MAP_FAILED)
+            {
+                close();
+                return false;
+            }
+            base_ = (unsigned char*)base;
+            madvise(base_, size_, MADV_SEQUENTIAL);
+            size_t page = (size_t)sysconf(_SC_PAGESIZE);
+            window_ = (windowBytes + page - 1) / page * page;
+            if (!window_)
+                window_ = page;
+            return true;
+        }
+        void close()
+        {
+            if (base_)
+                munmap(base_, size_);
+            if (fd_ >= 0)
+                ::close(fd_);
+            base_ = 0;
+            fd_ = -1;
+            size_ = 0;
+        }
+        size_t size() const
+        {
+            return size_;
+        }
+        size_t windows() const
+        {
+            return window_ ? (size_ + window_ - 1) / window_ : 0;
+        }
+        size_t windowBytes(size_t k) const
+        {
+            size_t offset = k * window_;
+            return (offset >= size_) ? 0 : ((size_ - offset < window_) ? size_ - offset : window_);
+        }
+        const void* window(size_t k) const
+        {
+            return base_ + k * window_;
+        }
+        /// kernel(size_t k, _Buffer& buf, GLsizeiptr bytes), on the thread of the current context.
+        ///  the kernel should not map buf, nor keep it after return.
+        template<typename _Fn>
+        bool run(_Fn kernel)
+        {
+            return run(0, windows(), kernel);
+        }
+        template<typename _Fn>
+        bool run(size_t first, size_t last, _Fn kernel)
+        {
+            if (!base_)
+                return false;
+            for (int i = 0; i < _Depth; ++i)
+            {
+                ring_[i].ensure();
+                ring_[i].alloc(window_, GL_STREAM_DRAW);
+                ring_[i].leave();
+            }
+            if (first < last)
+                prefetch(first);
+            for (size_t k = first; k < last; ++k)
+            {
+                int b = (int)(k % _Depth);
+                if (!waitFence(b))
+                    return false;
+                if (k + 1 < last)
+                    prefetch(k + 1);
+                GLsizeiptr bytes = (GLsizeiptr)windowBytes(k);
+                ring_[b].ensure();
+                /// the fence has been waited, no implicit sync
+                void* vaddr = ring_[b].mmapRange(0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+                if (!vaddr)
+                    return false;
+                memcpy(vaddr, window(k), bytes);
+                ring_[b].unmap();
+                evict(k);
+                kernel(k, ring_[b], bytes);
+                fences_[b] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            }
+            for (int i = 0; i < _Depth; ++i)
+                waitFence(i);
+            return true;
+        }
+    private:
+        void prefetch(size_t k)
+        {
+            madvise(base_ + k * window_, windowBytes(k), MADV_WILLNEED);
+        }
+        void evict(size_t k)
+        {
+            madvise(base_ + k * window_, windowBytes(k), MADV_DONTNEED);
+        }
+        bool waitFence(int b)
+        {
+            if (!fences_[b])
+                return true;
+            GLenum r = glClientWaitSync(fences_[b], GL_SYNC_FLUSH_COMMANDS_BIT, 10000000000ull);
+            glDeleteSync(fences_[b]);
+            fences_[b] = 0;
+            return r != GL_TIMEOUT_EXPIRED && r != GL_WAIT_FAILED;
+        }
+    };
+}; // NS GL3
+}; // NS zhelper
+
+#endif // __ZHELPER_STREAM_H_